@@ -0,0 +1,414 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                      //
+//  Copyright (c) 2016-2019 Leonardo Consoni <consoni_2519@hotmail.com>                 //
+//                                                                                      //
+//  This file is part of Platform Utils.                                                //
+//                                                                                      //
+//  Platform Utils is free software: you can redistribute it and/or modify              //
+//  it under the terms of the GNU Lesser General Public License as published            //
+//  by the Free Software Foundation, either version 3 of the License, or                //
+//  (at your option) any later version.                                                 //
+//                                                                                      //
+//  Platform Utils is distributed in the hope that it will be useful,                   //
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of                      //
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                        //
+//  GNU Lesser General Public License for more details.                                 //
+//                                                                                      //
+//  You should have received a copy of the GNU Lesser General Public License            //
+//  along with Platform Utils. If not, see <http://www.gnu.org/licenses/>.              //
+//                                                                                      //
+//////////////////////////////////////////////////////////////////////////////////////////
+
+// Measure parsing, serialization and lookup speed, and memory usage, over locally generated JSON corpora.
+// Usage: json_bench [-f csv|json] [-s <corpus scale>] [-t <minimum seconds per measurement>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "json.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/////                          HEAP USAGE COUNTERS                         /////
+////////////////////////////////////////////////////////////////////////////////
+
+// Allocations and live bytes come from the library's own counters. Only the peak of a single operation 
+// is tracked here, through the allocator hook, and only while explicitly requested
+static bool isTrackingPeak = false;
+static size_t peakBytes;
+
+static void TrackPeak( size_t size )
+{
+  // Library counters are updated after each call, so the requested block is added (reallocated ones may briefly coexist with the new copy)
+  size_t liveBytes = JSON_GetStats().liveBytes + size;
+  if( liveBytes > peakBytes ) peakBytes = liveBytes;
+}
+
+static void* AllocateCounted( void* context, size_t size )
+{
+  (void) context;
+  if( isTrackingPeak ) TrackPeak( size );
+  return malloc( size );
+}
+
+static void* ReallocateCounted( void* context, void* pointer, size_t size )
+{
+  (void) context;
+  if( isTrackingPeak ) TrackPeak( size );
+  return realloc( pointer, size );
+}
+
+static void ReleaseCounted( void* context, void* pointer )
+{
+  (void) context;
+  free( pointer );
+}
+
+static size_t GetAllocationsCount( void )
+{
+  JSONStats stats = JSON_GetStats();
+  return stats.allocationsCount + stats.reallocationsCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/////                               TIMING                                 /////
+////////////////////////////////////////////////////////////////////////////////
+
+static double GetTime( void )
+{
+#if defined( CLOCK_MONOTONIC )
+  struct timespec timeNow;
+  clock_gettime( CLOCK_MONOTONIC, &timeNow );
+  return timeNow.tv_sec + timeNow.tv_nsec / 1e9;
+#else
+  return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/////                          CORPUS GENERATION                           /////
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long randomState = 12345;
+
+// Fixed seed generator, for identical corpora on every run and platform
+static unsigned long GetRandom( void )
+{
+  randomState = randomState * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (unsigned long) ( randomState >> 33 );
+}
+
+static JSONNode CreateNumericCorpus( size_t scale )
+{
+  JSONNode root = JSON_Create( JSON_TYPE_BRACE, NULL );
+  JSONNode samplesList = JSON_AddKey( root, JSON_TYPE_BRACKET, "samples" );
+  JSON_Reserve( samplesList, 20000 * scale );
+  for( size_t sampleIndex = 0; sampleIndex < 20000 * scale; sampleIndex++ )
+  {
+    JSONNode sample = JSON_AddIndex( samplesList, JSON_TYPE_BRACKET );
+    JSON_SetInteger( JSON_AddIndex( sample, JSON_TYPE_NUMBER ), (long long) sampleIndex * 1000 );
+    for( int axisIndex = 0; axisIndex < 3; axisIndex++ )
+      JSON_SetNumber( JSON_AddIndex( sample, JSON_TYPE_NUMBER ), (double) GetRandom() / 1e4 - 1e5 );
+  }
+  return root;
+}
+
+static JSONNode CreateTextCorpus( size_t scale )
+{
+  static const char* WORDS[] = { "joint", "sensor", "motor", "position", "velocity", "torque", "control", "robot" };
+  char text[ 256 ];
+  JSONNode root = JSON_Create( JSON_TYPE_BRACKET, NULL );
+  for( size_t itemIndex = 0; itemIndex < 5000 * scale; itemIndex++ )
+  {
+    JSONNode item = JSON_AddIndex( root, JSON_TYPE_BRACE );
+    snprintf( text, sizeof(text), "item_%lu", (unsigned long) itemIndex );
+    JSON_Set( JSON_AddKey( item, JSON_TYPE_STRING, "name" ), text );
+    size_t textLength = 0;
+    while( textLength < 160 )
+      textLength += snprintf( text + textLength, sizeof(text) - textLength, "%s ", WORDS[ GetRandom() % 8 ] );
+    JSON_Set( JSON_AddKey( item, JSON_TYPE_STRING, "description" ), text );
+    JSON_Set( JSON_AddKey( item, JSON_TYPE_STRING, "category" ), WORDS[ GetRandom() % 8 ] );
+    JSON_SetBoolean( JSON_AddKey( item, JSON_TYPE_BOOLEAN, "enabled" ), GetRandom() % 2 );
+  }
+  return root;
+}
+
+#define NESTED_CORPUS_DEPTH   32
+
+static JSONNode CreateNestedCorpus( size_t scale )
+{
+  char key[ 32 ];
+  JSONNode root = JSON_Create( JSON_TYPE_BRACE, NULL );
+  for( size_t configIndex = 0; configIndex < 200 * scale; configIndex++ )
+  {
+    snprintf( key, sizeof(key), "config_%lu", (unsigned long) configIndex );
+    JSONNode level = JSON_AddKey( root, JSON_TYPE_BRACE, key );
+    for( int depth = 0; depth < NESTED_CORPUS_DEPTH; depth++ )
+    {
+      JSON_SetInteger( JSON_AddKey( level, JSON_TYPE_NUMBER, "id" ), depth );
+      JSON_Set( JSON_AddKey( level, JSON_TYPE_STRING, "label" ), "level" );
+      JSONNode limitsList = JSON_AddKey( level, JSON_TYPE_BRACKET, "limits" );
+      JSON_SetNumber( JSON_AddIndex( limitsList, JSON_TYPE_NUMBER ), -1.5 );
+      JSON_SetNumber( JSON_AddIndex( limitsList, JSON_TYPE_NUMBER ), 1.5 );
+      level = JSON_AddKey( level, JSON_TYPE_BRACE, "child" );
+    }
+  }
+  return root;
+}
+
+#define WIDE_CORPUS_KEYS    10000
+
+static JSONNode CreateWideCorpus( size_t scale )
+{
+  char key[ 32 ];
+  JSONNode root = JSON_Create( JSON_TYPE_BRACE, NULL );
+  (void) scale;                                         // Width is the point of this corpus, so it is not scaled
+  for( size_t keyIndex = 0; keyIndex < WIDE_CORPUS_KEYS; keyIndex++ )
+  {
+    snprintf( key, sizeof(key), "parameter_%05lu", (unsigned long) keyIndex );
+    JSON_SetInteger( JSON_AddKey( root, JSON_TYPE_NUMBER, key ), (long long) GetRandom() );
+  }
+  return root;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/////                              LOOKUPS                                 /////
+////////////////////////////////////////////////////////////////////////////////
+
+#define LOOKUP_KEYS_COUNT   1024
+
+static char lookupKeysList[ LOOKUP_KEYS_COUNT ][ 32 ];
+
+// Generate searched keys beforehand, so that only lookups are timed
+static void PrepareKeys( const char* keyFormat, size_t keysCount )
+{
+  for( size_t keyIndex = 0; keyIndex < LOOKUP_KEYS_COUNT; keyIndex++ )
+    snprintf( lookupKeysList[ keyIndex ], sizeof(lookupKeysList[ keyIndex ]), keyFormat, (unsigned long) ( ( keyIndex * 7919 ) % keysCount ) );
+}
+
+typedef struct _Corpus
+{
+  const char* name;
+  JSONNode (*create)( size_t scale );
+  const char* keyFormat;                                // Top level keys used by lookups (NULL if not generated)
+  // Lookups performed on parsed trees, returning number of successful finds
+  size_t (*findByKey)( JSONNode root, size_t count );
+  size_t (*findByPath)( JSONNode root, size_t count );
+}
+Corpus;
+
+static size_t FindNumericByKey( JSONNode root, size_t count )
+{
+  size_t foundCount = 0;
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByKey( root, "samples" ) != NULL );
+  return foundCount;
+}
+
+static size_t FindNumericByPath( JSONNode root, size_t count )
+{
+  size_t foundCount = 0, samplesCount = JSON_GetChildrenCount( JSON_FindByKey( root, "samples" ) );
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByPath( root, 3, "samples", (long) ( lookupIndex % samplesCount ), 2L ) != NULL );
+  return foundCount;
+}
+
+static size_t FindTextByKey( JSONNode root, size_t count )
+{
+  static const char* KEYS[] = { "name", "description", "category", "enabled" };
+  size_t foundCount = 0, itemsCount = JSON_GetChildrenCount( root );
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByKey( JSON_FindByIndex( root, (long) ( lookupIndex % itemsCount ) ), KEYS[ lookupIndex % 4 ] ) != NULL );
+  return foundCount;
+}
+
+static size_t FindTextByPath( JSONNode root, size_t count )
+{
+  size_t foundCount = 0, itemsCount = JSON_GetChildrenCount( root );
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByPath( root, 2, (long) ( lookupIndex % itemsCount ), "category" ) != NULL );
+  return foundCount;
+}
+
+static size_t FindNestedByKey( JSONNode root, size_t count )
+{
+  size_t foundCount = 0;
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByKey( root, lookupKeysList[ lookupIndex % LOOKUP_KEYS_COUNT ] ) != NULL );
+  return foundCount;
+}
+
+static size_t FindNestedByPath( JSONNode root, size_t count )
+{
+  size_t foundCount = 0;
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByPath( root, 10, "config_0", "child", "child", "child", "child", "child", "child", "child", "limits", 1L ) != NULL );
+  return foundCount;
+}
+
+static size_t FindWideByKey( JSONNode root, size_t count )
+{
+  size_t foundCount = 0;
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByKey( root, lookupKeysList[ lookupIndex % LOOKUP_KEYS_COUNT ] ) != NULL );
+  return foundCount;
+}
+
+static size_t FindWideByPath( JSONNode root, size_t count )
+{
+  size_t foundCount = 0;
+  for( size_t lookupIndex = 0; lookupIndex < count; lookupIndex++ )
+    foundCount += ( JSON_FindByPath( root, 1, "parameter_09999" ) != NULL );
+  return foundCount;
+}
+
+static const Corpus CORPORA_LIST[] =
+{
+  { "numeric_array", CreateNumericCorpus, NULL, FindNumericByKey, FindNumericByPath },
+  { "string_objects", CreateTextCorpus, NULL, FindTextByKey, FindTextByPath },
+  { "nested_config", CreateNestedCorpus, "config_%lu", FindNestedByKey, FindNestedByPath },
+  { "wide_object", CreateWideCorpus, "parameter_%05lu", FindWideByKey, FindWideByPath }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/////                               REPORT                                 /////
+////////////////////////////////////////////////////////////////////////////////
+
+enum { OUTPUT_CSV, OUTPUT_JSON };
+
+static int outputFormat = OUTPUT_CSV;
+static JSONNode resultsList = NULL;
+
+static void ReportResult( const char* corpus, const char* format, const char* metric, double value, const char* unit )
+{
+  if( outputFormat == OUTPUT_CSV )
+  {
+    printf( "%s,%s,%s,%.3f,%s\n", corpus, format, metric, value, unit );
+    return;
+  }
+  // Machine readable output built with the library itself, once all measurements are done
+  JSONNode result = JSON_AddIndex( resultsList, JSON_TYPE_BRACE );
+  JSON_Set( JSON_AddKey( result, JSON_TYPE_STRING, "corpus" ), corpus );
+  JSON_Set( JSON_AddKey( result, JSON_TYPE_STRING, "format" ), format );
+  JSON_Set( JSON_AddKey( result, JSON_TYPE_STRING, "metric" ), metric );
+  JSON_SetNumber( JSON_AddKey( result, JSON_TYPE_NUMBER, "value" ), value );
+  JSON_Set( JSON_AddKey( result, JSON_TYPE_STRING, "unit" ), unit );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/////                             MEASUREMENTS                             /////
+////////////////////////////////////////////////////////////////////////////////
+
+static double minimumTime = 0.5;
+
+static void MeasureParsing( const Corpus* corpus, const char* format, const char* text )
+{
+  size_t textLength = strlen( text );
+  // Memory of a single parse, including the resulting tree
+  size_t baseBytes = JSON_GetStats().liveBytes, baseAllocationsCount = GetAllocationsCount();
+  peakBytes = baseBytes;
+  isTrackingPeak = true;
+  JSONNode root = JSON_Parse( text );
+  isTrackingPeak = false;
+  size_t allocationsCount = GetAllocationsCount() - baseAllocationsCount;
+  JSON_Destroy( root );
+  // Fastest of repeated runs, filling the minimum measurement time
+  double bestTime = 1e9, totalTime = 0.0;
+  while( totalTime < minimumTime )
+  {
+    double startTime = GetTime();
+    root = JSON_Parse( text );
+    double elapsedTime = GetTime() - startTime;
+    if( elapsedTime < bestTime ) bestTime = elapsedTime;
+    totalTime += elapsedTime;
+    JSON_Destroy( root );
+  }
+  ReportResult( corpus->name, format, "parse_speed", textLength / bestTime / 1e6, "MB/s" );
+  ReportResult( corpus->name, format, "parse_allocations", (double) allocationsCount, "count" );
+  ReportResult( corpus->name, format, "parse_peak_heap", (double) ( peakBytes - baseBytes ), "bytes" );
+}
+
+static void MeasureSerialization( const Corpus* corpus, const char* format, int mode, JSONNode root )
+{
+  size_t textLength = 0, allocationsCount = 0;
+  double bestTime = 1e9, totalTime = 0.0;
+  while( totalTime < minimumTime )
+  {
+    size_t baseAllocationsCount = GetAllocationsCount();
+    double startTime = GetTime();
+    char* text = JSON_GetString( root, mode );
+    double elapsedTime = GetTime() - startTime;
+    if( elapsedTime < bestTime ) bestTime = elapsedTime;
+    totalTime += elapsedTime;
+    allocationsCount = GetAllocationsCount() - baseAllocationsCount;
+    textLength = strlen( text );
+    free( text );
+  }
+  ReportResult( corpus->name, format, "serialize_speed", textLength / bestTime / 1e6, "MB/s" );
+  ReportResult( corpus->name, format, "serialize_allocations", (double) allocationsCount, "count" );
+}
+
+static double MeasureLookup( JSONNode root, size_t (*find)( JSONNode, size_t ) )
+{
+  find( root, LOOKUP_KEYS_COUNT );                      // Warm up (and build lazy indexes)
+  size_t lookupsCount = 0;
+  double startTime = GetTime(), elapsedTime = 0.0;
+  while( elapsedTime < minimumTime )
+  {
+    find( root, LOOKUP_KEYS_COUNT );
+    lookupsCount += LOOKUP_KEYS_COUNT;
+    elapsedTime = GetTime() - startTime;
+  }
+  return elapsedTime * 1e9 / lookupsCount;
+}
+
+int main( int argc, char** argv )
+{
+  size_t scale = 1;
+  for( int argIndex = 1; argIndex + 1 < argc; argIndex += 2 )
+  {
+    if( strcmp( argv[ argIndex ], "-f" ) == 0 ) outputFormat = ( strcmp( argv[ argIndex + 1 ], "json" ) == 0 ) ? OUTPUT_JSON : OUTPUT_CSV;
+    else if( strcmp( argv[ argIndex ], "-s" ) == 0 ) scale = (size_t) strtoul( argv[ argIndex + 1 ], NULL, 10 );
+    else if( strcmp( argv[ argIndex ], "-t" ) == 0 ) minimumTime = strtod( argv[ argIndex + 1 ], NULL );
+  }
+  if( scale == 0 ) scale = 1;
+  JSON_SetAllocator( AllocateCounted, ReallocateCounted, ReleaseCounted, NULL );
+
+  if( outputFormat == OUTPUT_CSV ) printf( "corpus,format,metric,value,unit\n" );
+  else resultsList = JSON_Create( JSON_TYPE_BRACKET, NULL );
+
+  for( size_t corpusIndex = 0; corpusIndex < sizeof(CORPORA_LIST) / sizeof(Corpus); corpusIndex++ )
+  {
+    const Corpus* corpus = &(CORPORA_LIST[ corpusIndex ]);
+    JSONNode source = corpus->create( scale );
+    char* serialText = JSON_GetString( source, JSON_FORMAT_SERIAL );
+    char* indentedText = JSON_GetString( source, JSON_FORMAT_IDENT );
+    JSON_Destroy( source );
+
+    ReportResult( corpus->name, "serial", "size", (double) strlen( serialText ), "bytes" );
+    ReportResult( corpus->name, "indented", "size", (double) strlen( indentedText ), "bytes" );
+    MeasureParsing( corpus, "serial", serialText );
+    MeasureParsing( corpus, "indented", indentedText );
+
+    JSONNode root = JSON_Parse( serialText );
+    MeasureSerialization( corpus, "serial", JSON_FORMAT_SERIAL, root );
+    MeasureSerialization( corpus, "indented", JSON_FORMAT_IDENT, root );
+    if( corpus->keyFormat != NULL ) PrepareKeys( corpus->keyFormat, JSON_GetChildrenCount( root ) );
+    ReportResult( corpus->name, "tree", "find_by_key", MeasureLookup( root, corpus->findByKey ), "ns" );
+    ReportResult( corpus->name, "tree", "find_by_path", MeasureLookup( root, corpus->findByPath ), "ns" );
+    JSON_Destroy( root );
+
+    free( serialText );
+    free( indentedText );
+  }
+
+  if( outputFormat == OUTPUT_JSON )
+  {
+    JSON_Print( resultsList );
+    JSON_Destroy( resultsList );
+  }
+
+  return 0;
+}
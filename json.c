@@ -55,338 +55,4461 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <assert.h>
-#include <ctype.h>
 #include <stdio.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
 #include "json.h"
 
+#if defined( __unix__ ) || defined( __APPLE__ )
+  #define JSON_USE_POSIX
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sched.h>
+#endif
+
+#if defined( JSON_USE_POSIX ) && !defined( JSON_NO_THREADS )
+  #define JSON_USE_THREADS
+  #include <pthread.h>
+#endif
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || ( defined( __i386__ ) && defined( __SSE2__ ) ) ) && !defined( JSON_NO_SIMD )
+  #define JSON_USE_SIMD
+  #include <immintrin.h>
+#endif
+
 #define JSON_IS_INTERNAL( node ) ( (node)->type == JSON_TYPE_BRACKET || (node)->type == JSON_TYPE_BRACE )
 
+#define JSON_NODE_EXTERNAL   0x01    // Node structure is owned by an arena
+#define JSON_KEY_EXTERNAL    0x02    // Key string is owned by an arena or by the parsed buffer
+#define JSON_DATA_EXTERNAL   0x04    // Value string or children list is owned by an arena or by the parsed buffer
+#define JSON_VALUE_SLICE     0x08    // Value string is not null terminated
+#define JSON_SOURCE_MUTABLE  0x10    // Value slice points to a buffer that can be terminated in place
+#define JSON_INDEX_EXTERNAL  0x20    // Key index is owned by an arena
+#define JSON_NUMBER_CACHED   0x40    // Binary value of NUMBER node is valid
+#define JSON_NUMBER_INTEGER  0x80    // Binary value is stored as integer instead of double
+#define JSON_TEXT_STALE      0x100   // Value string is outdated and must be generated from binary value
+#define JSON_CHILDREN_PENDING 0x200  // Children of lazily parsed container are not read yet. Value points to its source text
+#define JSON_FROZEN          0x400   // Node and its descendants are immutable, and may be shared by several trees and threads
+#define JSON_KEY_SHARED      0x800   // Key string is the text of a JSONSharedKey, possibly used by other nodes
+
+#define JSON_NUMBER_MAX_LENGTH    32
+#define JSON_WRITER_STACK_SIZE    32          // Nesting levels handled without allocation, by the writer and tree builders
+
+#define JSON_KEY_INDEX_THRESHOLD  16  // Minimum number of children of BRACE nodes indexed by key hash
+#define JSON_CACHES_MAX           8   // Output caches reusing their last outputs at the same time (bits of cachedOutputs)
+
+enum { JSON_SOURCE_COPY, JSON_SOURCE_VIEW, JSON_SOURCE_IN_SITU };
+
 struct _JSONNodeData 
 {
-  unsigned long long type:3, childrenCount:61;
+  // Size is the number of children for BRACKET/BRACE nodes, value length otherwise. 
+  // Cached outputs are the caches (one bit each) whose last output of BRACKET/BRACE node is still valid
+  unsigned long long type:3, flags:13, cachedOutputs:8, size:40;
   char* key;
   union 
   {
     struct _JSONNodeData** childrenList;
     char *value;
   };
+  union 
+  {
+    struct _JSONNodeData* parent;                 // Container of modifiable node, whose cached output depends on it
+    unsigned int referencesCount;                 // Owners of frozen node (shared by any number of containers) and holders of snapshots including it
+  };
+  unsigned int keyLength;
+  unsigned int capacity;                          // Allocated children list slots for BRACKET/BRACE nodes, or source text length if pending
+  union 
+  {
+    struct _JSONKeyIndex* keyIndex;               // Children positions by key hash, for large BRACE nodes
+    long long integer;                            // Cached binary value of NUMBER nodes
+    double number;
+  };
+};
+
+// Immutable key string with precomputed hash, shared by nodes with the same key. Reference counted, unless owned by an arena
+typedef struct _JSONSharedKey
+{
+  unsigned int referencesCount;
+  unsigned int hash, length;
+  char text[];
+}
+JSONSharedKey;
+
+// Open addressing hash table of shared keys, sized to at most half full
+typedef struct _JSONKeysTable
+{
+  JSONSharedKey** slots;
+  size_t slotsCount, keysCount;
+}
+JSONKeysTable;
+
+#define JSON_GET_SHARED_KEY( key ) ( (JSONSharedKey*) ( (key) - offsetof( JSONSharedKey, text ) ) )
+
+typedef struct _JSONKeySlot
+{
+  unsigned int hash, position;                    // Child index + 1, or 0 for empty slots
+}
+JSONKeySlot;
+
+// Open addressing hash table, sized to at most half full
+typedef struct _JSONKeyIndex
+{
+  size_t slotsCount;                              // Power of 2
+  JSONKeySlot slots[];
+}
+JSONKeyIndex;
+
+#define JSON_ARENA_ALIGNMENT      ( 2 * sizeof(void*) )
+#define JSON_ARENA_BLOCK_SIZE     65536
+
+typedef struct _JSONArenaBlock
+{
+  struct _JSONArenaBlock* next;
+  size_t size, used;
+}
+JSONArenaBlock;
+
+#define JSON_ARENA_HEADER_SIZE    ( ( sizeof(JSONArenaBlock) + JSON_ARENA_ALIGNMENT - 1 ) & ~( JSON_ARENA_ALIGNMENT - 1 ) )
+
+struct _JSONArenaData
+{
+  JSONArenaBlock* firstBlock;
+  JSONArenaBlock* currentBlock;
+  size_t blockSize;
+  JSONKeysTable keysTable;            // Keys of all documents parsed into the arena since its last reset
 };
 
+// Byte classification loops used by the tokenizer, selected at runtime
+typedef struct _JSONScanner
+{
+  const char* (*skipSpaces)( const char* data, const char* end );
+  const char* (*findStringEnd)( const char* data, const char* end, char quote );
+  const char* (*findTokenEnd)( const char* data, const char* end );
+}
+JSONScanner;
+
+typedef struct _JSONParserFrame
+{
+  JSONNode container;
+  size_t stackBase;                   // Position of its first child in children stack
+}
+JSONParserFrame;
+
+typedef struct _JSONParser
+{
+  JSONArena arena;                    // Allocation source for nodes and strings. NULL for heap
+  int sourceMode;                     // Copy strings or reference them inside the parsed buffer
+  const char* end;                    // Parsing never reads at or past this position
+  const JSONScanner* scanner;
+  char* delimitersStack;              // Closing delimiter of each open container, innermost last
+  size_t depth, delimitersStackSize;
+  size_t maxDepth;                    // Maximum nesting level of containers. 0 for no limit
+  bool isLazy;                        // Only locate nested containers, leaving their children to be read on first access
+  bool isChecked;                     // Text was already validated, so that nested containers are located by their delimiters only
+  JSONNode root;                      // Tree built so far, once the top level element is complete
+  JSONNode* childrenStack;            // Children of containers still being parsed, moved to their lists when closed
+  size_t childrenStackLength, childrenStackSize;
+  JSONParserFrame* containersStack;   // Containers of the tree still open, innermost last
+  size_t containersCount, containersStackSize;
+  JSONKeysTable keysTable;            // Keys copied so far, reused for equal keys. Arenas keep their own, used instead
+}
+JSONParser;
+
+
+// Constant pointers to constant strings: only read, so shared safely by parsers running in different threads
+const char* const NULL_STR = "null";
+const char* const TRUE_STR = "true";
+const char* const FALSE_STR = "false";
+
+// Whitespace as in the C locale isspace(): ' ', '\t', '\n', '\v', '\f' and '\r'
+#define JSON_IS_SPACE( c ) ( (c) == ' ' || (unsigned char) ( (c) - '\t' ) <= '\r' - '\t' )
+
+static const char* JSON_SkipSpacesScalar( const char* data, const char* end )
+{
+  while( data < end && JSON_IS_SPACE( *data ) ) ++data;
+  return data;
+}
+
+static const char* JSON_FindStringEndScalar( const char* data, const char* end, char quote )
+{
+  for( ; data < end && *data != quote; ++data )
+    if( *data == '\\' && data + 1 < end ) ++data;
+  return data;
+}
+
+static const char* JSON_FindTokenEndScalar( const char* data, const char* end )
+{
+  for( ; data < end && *data != ']' && *data != '}' && *data != ',' && *data != ':' && *data != '\n'; ++data )
+    if( *data == '\\' && data + 1 < end ) ++data;
+  return data;
+}
+
+#ifndef JSON_USE_SIMD
+
+static const JSONScanner JSON_SCALAR_SCANNER = { JSON_SkipSpacesScalar, JSON_FindStringEndScalar, JSON_FindTokenEndScalar };
 
-const char *NULL_STR = "null";
-const char *TRUE_STR = "true";
-const char *FALSE_STR = "false";
+#else
 
+// Vector versions classify a whole block at once and fall back to the scalar loops for the tail
+// and for escape sequences, so they stop at exactly the same positions
 
-JSONNode JSON_ParseRecursive( const char** ref_jsonString, int* error )
+static const char* JSON_SkipSpacesSSE2( const char* data, const char* end )
 {
-  const char* ref_jsonToken;
-  JSONNode root = JSON_Create( JSON_TYPE_NULL, NULL );
-  *error = JSON_OK;
-  for( ref_jsonToken = *ref_jsonString; *ref_jsonToken != 0; ++ref_jsonToken ) {
-    while( *ref_jsonToken && isspace( *ref_jsonToken ) ) ++ref_jsonToken;
-    if( *ref_jsonToken == 0 ) break;
-    if( *ref_jsonToken == ',' || *ref_jsonToken == ']' || *ref_jsonToken == '}' ) break;
-    else if( *ref_jsonToken == '[' || *ref_jsonToken == '{' ) 
+  const __m128i space = _mm_set1_epi8( ' ' ), tab = _mm_set1_epi8( '\t' ), controlRange = _mm_set1_epi8( '\r' - '\t' );
+  while( end - data >= 16 )
+  {
+    __m128i block = _mm_loadu_si128( (const __m128i*) data );
+    __m128i controlOffset = _mm_sub_epi8( block, tab );
+    __m128i isSpace = _mm_or_si128( _mm_cmpeq_epi8( block, space ), 
+                                    _mm_cmpeq_epi8( _mm_min_epu8( controlOffset, controlRange ), controlOffset ) );
+    unsigned int mask = ~( (unsigned int) _mm_movemask_epi8( isSpace ) ) & 0xFFFF;
+    if( mask != 0 ) return data + __builtin_ctz( mask );
+    data += 16;
+  }
+  return JSON_SkipSpacesScalar( data, end );
+}
+
+static const char* JSON_FindStringEndSSE2( const char* data, const char* end, char quote )
+{
+  const __m128i quoteChar = _mm_set1_epi8( quote ), escapeChar = _mm_set1_epi8( '\\' );
+  while( end - data >= 16 )
+  {
+    __m128i block = _mm_loadu_si128( (const __m128i*) data );
+    unsigned int mask = (unsigned int) _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( block, quoteChar ), 
+                                                                        _mm_cmpeq_epi8( block, escapeChar ) ) );
+    if( mask == 0 ) 
     {
-      char delimiter = ( *ref_jsonToken == '[' ) ? ']' : '}';
-      root->type = ( *(ref_jsonToken++) == '[' ) ? JSON_TYPE_BRACKET : JSON_TYPE_BRACE;
-      while( *ref_jsonToken != delimiter && *error == JSON_OK ) 
-      {
-        JSONNode v = JSON_ParseRecursive( &ref_jsonToken, error );
-        if( v ) 
-        {
-          root->childrenList = (JSONNode*) realloc( root->childrenList, (size_t) ( root->childrenCount + 1 ) * sizeof(JSONNode) );
-          root->childrenList[ root->childrenCount++ ] = v;
-          if( delimiter == ']' ) v->key = NULL;
-        }
-        if( *ref_jsonToken == ',' ) ++ref_jsonToken;
-        else if( *ref_jsonToken != delimiter ) *error = JSON_ERROR_UNEXPECTED;
-      }
+      data += 16;
       continue;
-    } 
-    else if( *ref_jsonToken == ':' ) 
-    {
-      if( !root->value ) 
-      {
-        *error = JSON_ERROR_NO_KEY; 
-        break;
-      }
-      if( root->key ) {
-      *error = JSON_ERROR_UNEXPECTED; 
-      break;
-      }
-      root->key = root->value;
-      root->value = NULL;
-    } 
-    else 
-    {
-      int c = *ref_jsonToken;
-      const char* q;
-      // Parse string
-      if( c == '\'' || c == '"' ) 
-      {
-        for( q = ++ref_jsonToken; *q && *q != c; ++q )
-          if( *q == '\\' ) ++q;
-      } 
-      else 
-      {
-        for( q = ref_jsonToken; *q && *q != ']' && *q != '}' && *q != ',' && *q != ':' && *q != '\n'; ++q )
-          if( *q == '\\' ) ++q;
-      }
-      root->value = (char*) malloc( q - ref_jsonToken + 1 ); 
-      strncpy( root->value, ref_jsonToken, q - ref_jsonToken ); 
-      root->value[ q - ref_jsonToken ] = 0; // equivalent to u->value=strndup(p, q-p)
-      if( c == '\'' || c == '"' ) root->type = JSON_TYPE_STRING; 
-      else if( strcmp( root->value, NULL_STR ) == 0 ) root->type = JSON_TYPE_NULL;
-      else if( strcmp( root->value, "true" ) == 0 || strcmp( root->value, "false" ) == 0) root->type = JSON_TYPE_BOOLEAN;
-      else root->type = JSON_TYPE_NUMBER;
-      ref_jsonToken = ( c == '\'' || c == '"' ) ? q : q - 1;
     }
+    data += __builtin_ctz( mask );
+    if( *data == quote ) return data;
+    if( end - data <= 2 ) return end;                       // Escape sequence reaches the end of input
+    data += 2;
   }
-  *ref_jsonString = ref_jsonToken;
-  if( !JSON_IS_INTERNAL( root ) ) 
+  return JSON_FindStringEndScalar( data, end, quote );
+}
+
+static const char* JSON_FindTokenEndSSE2( const char* data, const char* end )
+{
+  const __m128i bracket = _mm_set1_epi8( ']' ), brace = _mm_set1_epi8( '}' ), comma = _mm_set1_epi8( ',' );
+  const __m128i colon = _mm_set1_epi8( ':' ), newLine = _mm_set1_epi8( '\n' ), escapeChar = _mm_set1_epi8( '\\' );
+  while( end - data >= 16 )
   {
-    if( !root->value ) 
+    __m128i block = _mm_loadu_si128( (const __m128i*) data );
+    __m128i isEnd = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( block, bracket ), _mm_cmpeq_epi8( block, brace ) ),
+                                  _mm_or_si128( _mm_cmpeq_epi8( block, comma ), _mm_cmpeq_epi8( block, colon ) ) );
+    isEnd = _mm_or_si128( isEnd, _mm_or_si128( _mm_cmpeq_epi8( block, newLine ), _mm_cmpeq_epi8( block, escapeChar ) ) );
+    unsigned int mask = (unsigned int) _mm_movemask_epi8( isEnd );
+    if( mask == 0 ) 
     {
-      JSON_Destroy( root ); 
-      root = 0;
+      data += 16;
+      continue;
     }
+    data += __builtin_ctz( mask );
+    if( *data != '\\' ) return data;
+    if( end - data <= 2 ) return end;
+    data += 2;
   }
-  return root;
+  return JSON_FindTokenEndScalar( data, end );
 }
 
-JSONNode JSON_Parse( const char *jsonString )
+static const JSONScanner JSON_SSE2_SCANNER = { JSON_SkipSpacesSSE2, JSON_FindStringEndSSE2, JSON_FindTokenEndSSE2 };
+
+__attribute__(( target( "avx2" ) ))
+static const char* JSON_SkipSpacesAVX2( const char* data, const char* end )
 {
-  int error;
-  JSONNode root = JSON_ParseRecursive( &jsonString, &error );
-  if( !root->type || error != JSON_OK ) 
+  const __m256i space = _mm256_set1_epi8( ' ' ), tab = _mm256_set1_epi8( '\t' ), controlRange = _mm256_set1_epi8( '\r' - '\t' );
+  while( end - data >= 32 )
   {
-    JSON_Destroy( root );
-    return NULL;
+    __m256i block = _mm256_loadu_si256( (const __m256i*) data );
+    __m256i controlOffset = _mm256_sub_epi8( block, tab );
+    __m256i isSpace = _mm256_or_si256( _mm256_cmpeq_epi8( block, space ), 
+                                       _mm256_cmpeq_epi8( _mm256_min_epu8( controlOffset, controlRange ), controlOffset ) );
+    unsigned int mask = ~( (unsigned int) _mm256_movemask_epi8( isSpace ) );
+    if( mask != 0 ) return data + __builtin_ctz( mask );
+    data += 32;
   }
-  return root;
+  return JSON_SkipSpacesSSE2( data, end );
 }
 
-JSONNode JSON_Create( enum JSONNodeType type, const char* key )
+__attribute__(( target( "avx2" ) ))
+static const char* JSON_FindStringEndAVX2( const char* data, const char* end, char quote )
 {
-  JSONNode newNode = (JSONNode) malloc( sizeof(JSONNodeData) );
-  newNode->key = NULL;
-  if( key ) 
+  const __m256i quoteChar = _mm256_set1_epi8( quote ), escapeChar = _mm256_set1_epi8( '\\' );
+  while( end - data >= 32 )
   {
-    newNode->key = (char*) calloc( strlen( key ) + 1, sizeof(char) );
-    strcpy( newNode->key, key );
+    __m256i block = _mm256_loadu_si256( (const __m256i*) data );
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( block, quoteChar ), 
+                                                                              _mm256_cmpeq_epi8( block, escapeChar ) ) );
+    if( mask == 0 ) 
+    {
+      data += 32;
+      continue;
+    }
+    data += __builtin_ctz( mask );
+    if( *data == quote ) return data;
+    if( end - data <= 2 ) return end;
+    data += 2;
   }
-  newNode->type = (long) type;
-  if( JSON_IS_INTERNAL( newNode ) ) newNode->childrenList = NULL;
-  else newNode->value = NULL;
-  newNode->childrenCount = 0;
-  return newNode;
+  return JSON_FindStringEndSSE2( data, end, quote );
 }
 
-JSONNode JSON_AddNode( JSONNode root, enum JSONNodeType type, const char *key )
+__attribute__(( target( "avx2" ) ))
+static const char* JSON_FindTokenEndAVX2( const char* data, const char* end )
 {
-  if( root->childrenCount++ == 0 ) root->childrenList = NULL;
-  root->childrenList = (JSONNode*) realloc( root->childrenList, (size_t) root->childrenCount * sizeof(JSONNode) );
-  root->childrenList[ root->childrenCount - 1 ] = JSON_Create( type, key );
-  if( root->childrenList[ root->childrenCount - 1 ]->type == JSON_TYPE_NULL ) 
-    JSON_Set( root->childrenList[ root->childrenCount - 1 ], NULL );
-  return root->childrenList[ root->childrenCount - 1 ];
+  const __m256i bracket = _mm256_set1_epi8( ']' ), brace = _mm256_set1_epi8( '}' ), comma = _mm256_set1_epi8( ',' );
+  const __m256i colon = _mm256_set1_epi8( ':' ), newLine = _mm256_set1_epi8( '\n' ), escapeChar = _mm256_set1_epi8( '\\' );
+  while( end - data >= 32 )
+  {
+    __m256i block = _mm256_loadu_si256( (const __m256i*) data );
+    __m256i isEnd = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( block, bracket ), _mm256_cmpeq_epi8( block, brace ) ),
+                                     _mm256_or_si256( _mm256_cmpeq_epi8( block, comma ), _mm256_cmpeq_epi8( block, colon ) ) );
+    isEnd = _mm256_or_si256( isEnd, _mm256_or_si256( _mm256_cmpeq_epi8( block, newLine ), _mm256_cmpeq_epi8( block, escapeChar ) ) );
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8( isEnd );
+    if( mask == 0 ) 
+    {
+      data += 32;
+      continue;
+    }
+    data += __builtin_ctz( mask );
+    if( *data != '\\' ) return data;
+    if( end - data <= 2 ) return end;
+    data += 2;
+  }
+  return JSON_FindTokenEndSSE2( data, end );
 }
 
-JSONNode JSON_AddKey( JSONNode root, enum JSONNodeType type, const char* key )
+static const JSONScanner JSON_AVX2_SCANNER = { JSON_SkipSpacesAVX2, JSON_FindStringEndAVX2, JSON_FindTokenEndAVX2 };
+
+#endif // JSON_USE_SIMD
+
+// Select the widest scanner supported by the running CPU
+static const JSONScanner* JSON_GetScanner( void )
 {
-  if( root->type != JSON_TYPE_BRACE ) return NULL;
-  for( long childIndex = 0; childIndex < (long) root->childrenCount; ++childIndex ) 
-  {
-    JSONNode child = root->childrenList[ childIndex ];
-    if( child->key != NULL && strcmp( child->key, key ) == 0 )
-    return child; // (child->type == type) ? child : NULL;
-  }
-  return JSON_AddNode( root, type, key );
+#ifdef JSON_USE_SIMD
+  if( __builtin_cpu_supports( "avx2" ) ) return &JSON_AVX2_SCANNER;
+  return &JSON_SSE2_SCANNER;
+#else
+  return &JSON_SCALAR_SCANNER;
+#endif
 }
 
-JSONNode JSON_AddIndex( JSONNode root, enum JSONNodeType type )
+// Skip whitespace, checking the common case of no/single separator before calling the scanner
+static inline const char* JSON_SkipSpaces( const JSONScanner* scanner, const char* data, const char* end )
 {
-  if( root->type != JSON_TYPE_BRACKET ) return NULL;
-  return JSON_AddNode( root, type, NULL );
+  if( data < end && !JSON_IS_SPACE( *data ) ) return data;
+  if( data + 1 < end && !JSON_IS_SPACE( data[ 1 ] ) ) return data + 1;
+  return scanner->skipSpaces( data, end );
 }
 
-enum JSONNodeType JSON_GetType( JSONNode root )
+
+typedef struct _JSONAllocator
 {
-  return (enum JSONNodeType) root->type;
+  void* (*allocate)( void* context, size_t size );
+  void* (*reallocate)( void* context, void* pointer, size_t size );
+  void (*release)( void* context, void* pointer );
+  void* context;
 }
+JSONAllocator;
 
-const char* JSON_Get( JSONNode root )
+static JSONAllocator allocator;       // Standard library functions are called directly while not set
+
+// Counters updated with relaxed atomic operations, as any thread may allocate or parse at any time
+typedef struct _JSONCounters
 {
-  if( JSON_IS_INTERNAL( root ) ) return NULL;
-  
-  return (const char*) root->value;
+  size_t liveNodes, liveBytes, peakBytes;
+  size_t allocationsCount, reallocationsCount;
+  unsigned long long parseTime, serializeTime;      // Nanoseconds
 }
+JSONCounters;
 
-unsigned long JSON_GetChildrenCount( JSONNode root )
+static JSONCounters counters;
+
+#if defined( __GNUC__ )
+  #define JSON_ADD_COUNTER( counter, value ) __atomic_add_fetch( &(counter), (value), __ATOMIC_RELAXED )
+  #define JSON_READ_COUNTER( counter ) __atomic_load_n( &(counter), __ATOMIC_RELAXED )
+  #define JSON_WRITE_COUNTER( counter, value ) __atomic_store_n( &(counter), (value), __ATOMIC_RELAXED )
+#else
+  #define JSON_ADD_COUNTER( counter, value ) ( (counter) += (value) )
+  #define JSON_READ_COUNTER( counter ) (counter)
+  #define JSON_WRITE_COUNTER( counter, value ) ( (counter) = (value) )
+#endif
+
+// Sequentially consistent operations on data shared by snapshot readers and writers
+#if defined( __GNUC__ )
+  #define JSON_LOAD_SHARED( variable ) __atomic_load_n( &(variable), __ATOMIC_SEQ_CST )
+  #define JSON_STORE_SHARED( variable, value ) __atomic_store_n( &(variable), (value), __ATOMIC_SEQ_CST )
+  #define JSON_ADD_SHARED( variable, value ) __atomic_add_fetch( &(variable), (value), __ATOMIC_SEQ_CST )
+  #define JSON_SWAP_SHARED( variable, ref_expected, value ) __atomic_compare_exchange_n( &(variable), (ref_expected), (value), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )
+#else
+  #define JSON_LOAD_SHARED( variable ) (variable)
+  #define JSON_STORE_SHARED( variable, value ) ( (variable) = (value) )
+  #define JSON_ADD_SHARED( variable, value ) ( (variable) += (value) )
+  #define JSON_SWAP_SHARED( variable, ref_expected, value ) ( ( (variable) == *(ref_expected) ) ? ( (variable) = (value), true ) : ( *(ref_expected) = (variable), false ) )
+#endif
+
+static inline void JSON_CountBytes( size_t addedSize, size_t removedSize )
 {
-  return root->childrenCount;
+  size_t liveBytes = JSON_ADD_COUNTER( counters.liveBytes, addedSize - removedSize );    // Wraps around for decrements
+  if( addedSize <= removedSize ) return;
+  // Plain store instead of compare-and-swap loop: concurrent updates may rarely lower the peak by a few allocations
+  if( liveBytes > JSON_READ_COUNTER( counters.peakBytes ) ) JSON_WRITE_COUNTER( counters.peakBytes, liveBytes );
 }
 
-void JSON_Set( JSONNode root, const char* value )
+// Heap memory functions take the sizes of released blocks, so that live memory is tracked without headers
+static void* JSON_AllocateHeap( size_t size )
 {
-  if( JSON_IS_INTERNAL( root ) ) return;
-  if( root->value ) 
-  {
-    free( root->value );
-    root->value = NULL;
-  }
-  if( root->type == JSON_TYPE_BOOLEAN ) value = (value) ? TRUE_STR : FALSE_STR;
-  else if( root->type == JSON_TYPE_NULL ) value = NULL_STR;
-  if( value ) 
-  {
-    root->value = (char*) realloc( root->value, ( strlen( value ) + 1 ) * sizeof(char) );
-    strcpy( root->value, value );
-  }
+  void* newData = ( allocator.allocate != NULL ) ? allocator.allocate( allocator.context, size ) : malloc( size );
+  if( newData == NULL ) return NULL;
+  JSON_ADD_COUNTER( counters.allocationsCount, 1 );
+  JSON_CountBytes( size, 0 );
+  return newData;
 }
 
-void JSON_Clear( JSONNode root )
+static void* JSON_ResizeHeap( void* data, size_t oldSize, size_t newSize )
 {
-  if( root == NULL ) return;
-  if( JSON_IS_INTERNAL( root ) ) 
+  if( data == NULL ) return JSON_AllocateHeap( newSize );
+  void* newData = ( allocator.reallocate != NULL ) ? allocator.reallocate( allocator.context, data, newSize ) : realloc( data, newSize );
+  if( newData == NULL ) return NULL;
+  JSON_ADD_COUNTER( counters.reallocationsCount, 1 );
+  JSON_CountBytes( newSize, oldSize );
+  return newData;
+}
+
+static void JSON_FreeHeap( void* data, size_t size )
+{
+  if( data == NULL ) return;
+  if( allocator.release != NULL ) allocator.release( allocator.context, data );
+  else free( data );
+  JSON_CountBytes( 0, size );
+}
+
+static unsigned long long JSON_GetTime( void )
+{
+#ifdef JSON_USE_POSIX
+  struct timespec timeNow;
+  clock_gettime( CLOCK_MONOTONIC, &timeNow );
+  return (unsigned long long) timeNow.tv_sec * 1000000000ULL + (unsigned long long) timeNow.tv_nsec;
+#else
+  return (unsigned long long) ( (double) clock() * 1e9 / CLOCKS_PER_SEC );
+#endif
+}
+
+void JSON_SetAllocator( void* (*allocate)( void* context, size_t size ), void* (*reallocate)( void* context, void* pointer, size_t size ),
+                        void (*release)( void* context, void* pointer ), void* context )
+{
+  if( allocate == NULL || reallocate == NULL || release == NULL ) allocator = (JSONAllocator) { NULL, NULL, NULL, NULL };
+  else allocator = (JSONAllocator) { allocate, reallocate, release, context };
+}
+
+JSONStats JSON_GetStats( void )
+{
+  JSONStats stats;
+  stats.liveNodes = JSON_READ_COUNTER( counters.liveNodes );
+  stats.liveBytes = JSON_READ_COUNTER( counters.liveBytes );
+  stats.peakBytes = JSON_READ_COUNTER( counters.peakBytes );
+  stats.allocationsCount = JSON_READ_COUNTER( counters.allocationsCount );
+  stats.reallocationsCount = JSON_READ_COUNTER( counters.reallocationsCount );
+  stats.parseTime = JSON_READ_COUNTER( counters.parseTime ) / 1e9;
+  stats.serializeTime = JSON_READ_COUNTER( counters.serializeTime ) / 1e9;
+  return stats;
+}
+
+
+static JSONArenaBlock* JSON_CreateArenaBlock( size_t dataSize )
+{
+  JSONArenaBlock* newBlock = (JSONArenaBlock*) JSON_AllocateHeap( JSON_ARENA_HEADER_SIZE + dataSize );
+  if( newBlock == NULL ) return NULL;
+  newBlock->next = NULL;
+  newBlock->size = dataSize;
+  newBlock->used = 0;
+  return newBlock;
+}
+
+static void* JSON_AllocateFromArena( JSONArena arena, size_t size )
+{
+  size = ( size + JSON_ARENA_ALIGNMENT - 1 ) & ~( JSON_ARENA_ALIGNMENT - 1 );
+  JSONArenaBlock* block = arena->currentBlock;
+  if( block->used + size > block->size )
   {
-    for( long childIndex = 0; childIndex < (long) root->childrenCount; ++childIndex ) 
+    // Reuse blocks kept by a previous reset when possible, otherwise insert a new one after the current
+    if( block->next != NULL && block->next->size >= size ) 
     {
-      JSON_Clear( root->childrenList[ childIndex ] );
-      free( root->childrenList[ childIndex ] );
+      block = block->next;
+      block->used = 0;
     }
-    if( root->childrenList ) free( root->childrenList );
-    root->childrenList = NULL;
+    else
+    {
+      JSONArenaBlock* newBlock = JSON_CreateArenaBlock( ( size > arena->blockSize ) ? size : arena->blockSize );
+      if( newBlock == NULL ) return NULL;
+      newBlock->next = block->next;
+      block->next = newBlock;
+      block = newBlock;
+    }
+    arena->currentBlock = block;
   }
-  else 
+  void* data = (char*) block + JSON_ARENA_HEADER_SIZE + block->used;
+  block->used += size;
+  return data;
+}
+
+static inline void* JSON_Allocate( JSONArena arena, size_t size )
+{
+  return ( arena != NULL ) ? JSON_AllocateFromArena( arena, size ) : JSON_AllocateHeap( size );
+}
+
+static char* JSON_CopyString( JSONArena arena, const char* string, size_t length )
+{
+  char* newString = (char*) JSON_Allocate( arena, length + 1 );
+  if( newString == NULL ) return NULL;
+  memcpy( newString, string, length );
+  newString[ length ] = '\0';
+  return newString;
+}
+
+static void JSON_ReleaseNode( JSONNode node )
+{
+  JSON_FreeHeap( node, sizeof(JSONNodeData) );
+  JSON_ADD_COUNTER( counters.liveNodes, (size_t) -1 );
+}
+
+static JSONNode JSON_CreateNode( JSONArena arena, enum JSONNodeType type )
+{
+  JSONNode newNode = (JSONNode) JSON_Allocate( arena, sizeof(JSONNodeData) );
+  if( newNode == NULL ) return NULL;
+  if( arena == NULL ) JSON_ADD_COUNTER( counters.liveNodes, 1 );
+  newNode->type = (long) type;
+  newNode->flags = ( arena != NULL ) ? ( JSON_NODE_EXTERNAL | JSON_KEY_EXTERNAL | JSON_DATA_EXTERNAL ) : 0;
+  newNode->cachedOutputs = 0;
+  newNode->size = 0;
+  newNode->key = NULL;
+  newNode->keyLength = 0;
+  newNode->capacity = 0;
+  newNode->value = NULL;
+  newNode->parent = NULL;
+  newNode->keyIndex = NULL;
+  return newNode;
+}
+
+// Drop cached outputs of given container and its ancestors, for all caches. Containers without valid output have no cached ancestors either
+static inline void JSON_InvalidateOutput( JSONNode node )
+{
+  while( node != NULL && node->cachedOutputs != 0 ) 
   {
-    if( root->value ) free( root->value );
-    root->value = NULL;
+    node->cachedOutputs = 0;
+    node = node->parent;
   }
-  root->childrenCount = 0;
 }
 
-void JSON_Destroy( JSONNode root )
+static inline bool JSON_IsToken( const char* string, size_t length, const char* token )
 {
-  if( root ) return;
-  JSON_Clear( root );
-  if( root->key ) free( root->key );
-  root->key = NULL;
-  free( root );
+  return ( strncmp( string, token, length ) == 0 && token[ length ] == '\0' );
 }
 
-JSONNode JSON_FindByKey( const JSONNode root, const char* key )
+// Trim trailing whitespace (not part of bare tokens) and classify token, returning its literal string if it is one
+static enum JSONNodeType JSON_ReadBareToken( const char* token, size_t* ref_length, const char** ref_literal )
 {
-  if( !JSON_IS_INTERNAL( root ) ) return NULL;
-  for( long childIndex = 0; childIndex < (long) root->childrenCount; ++childIndex ) 
+  size_t length = *ref_length;
+  while( length > 0 && JSON_IS_SPACE( token[ length - 1 ] ) ) length--;
+  *ref_length = length;
+  *ref_literal = NULL;
+  if( JSON_IsToken( token, length, NULL_STR ) ) *ref_literal = NULL_STR;
+  else if( JSON_IsToken( token, length, TRUE_STR ) ) *ref_literal = TRUE_STR;
+  else if( JSON_IsToken( token, length, FALSE_STR ) ) *ref_literal = FALSE_STR;
+  else return JSON_TYPE_NUMBER;
+  return ( *ref_literal == NULL_STR ) ? JSON_TYPE_NULL : JSON_TYPE_BOOLEAN;
+}
+
+static bool JSON_SetValueSlice( JSONParser* parser, JSONNode node, const char* string, size_t length )
+{
+  if( parser->sourceMode == JSON_SOURCE_COPY ) 
   {
-    JSONNode child = root->childrenList[ childIndex ];
-    if( child->key && strcmp( child->key, key ) == 0 )
-      return child;
+    node->value = JSON_CopyString( parser->arena, string, length );
+    if( node->value == NULL ) return false;
   }
-  return NULL;
+  else
+  {
+    node->value = (char*) string;
+    node->flags |= JSON_DATA_EXTERNAL | JSON_VALUE_SLICE;
+    if( parser->sourceMode == JSON_SOURCE_IN_SITU && string + length < parser->end ) node->flags |= JSON_SOURCE_MUTABLE;
+  }
+  node->size = length;
+  return true;
 }
 
-JSONNode JSON_FindByIndex( const JSONNode root, long index )
+static bool JSON_IsKey( JSONNode node, const char* key, size_t keyLength )
 {
-  if( !JSON_IS_INTERNAL( root ) ) return NULL;
-  return( 0 <= index && index < (long) root->childrenCount ) ? root->childrenList[ index ] : NULL;
+  return ( node->key != NULL && node->keyLength == keyLength && ( node->key == key || memcmp( node->key, key, keyLength ) == 0 ) );
 }
 
-JSONNode JSON_FindByPath( const JSONNode root, int pathArgsCount, ... )
+static inline unsigned int JSON_HashKey( const char* key, size_t keyLength )
 {
-  va_list pathArgsList;
-  va_start( pathArgsList, pathArgsCount );
-  JSONNode child = (JSONNode) root;
-  while( child != NULL && pathArgsCount > 0 ) 
+  unsigned int hash = 2166136261u;                // 32 bits FNV-1a
+  for( size_t charIndex = 0; charIndex < keyLength; charIndex++ )
+    hash = ( hash ^ (unsigned char) key[ charIndex ] ) * 16777619u;
+  return hash;
+}
+
+static inline unsigned int JSON_GetKeyHash( const JSONNode node )
+{
+  if( node->flags & JSON_KEY_SHARED ) return JSON_GET_SHARED_KEY( node->key )->hash;
+  return JSON_HashKey( node->key, node->keyLength );
+}
+
+// Compare precomputed hashes first, so that shared keys are rejected without reading their text
+static inline bool JSON_IsHashedKey( JSONNode node, const char* key, size_t keyLength, unsigned int hash )
+{
+  if( ( node->flags & JSON_KEY_SHARED ) && JSON_GET_SHARED_KEY( node->key )->hash != hash ) return false;
+  return JSON_IsKey( node, key, keyLength );
+}
+
+static char* JSON_CreateKey( JSONArena arena, const char* key, size_t keyLength, unsigned int hash )
+{
+  JSONSharedKey* newKey = (JSONSharedKey*) JSON_Allocate( arena, sizeof(JSONSharedKey) + keyLength + 1 );
+  if( newKey == NULL ) return NULL;
+  newKey->referencesCount = 1;
+  newKey->hash = hash;
+  newKey->length = (unsigned int) keyLength;
+  memcpy( newKey->text, key, keyLength );
+  newKey->text[ keyLength ] = '\0';
+  return newKey->text;
+}
+
+// Keys may be shared by nodes of different trees (even frozen ones), so references are counted atomically
+static inline char* JSON_RetainKey( char* key )
+{
+  JSON_ADD_SHARED( JSON_GET_SHARED_KEY( key )->referencesCount, 1 );
+  return key;
+}
+
+static inline void JSON_ReleaseSharedKey( JSONSharedKey* sharedKey )
+{
+  if( JSON_ADD_SHARED( sharedKey->referencesCount, (unsigned int) -1 ) == 0 ) 
+    JSON_FreeHeap( sharedKey, sizeof(JSONSharedKey) + sharedKey->length + 1 );
+}
+
+static void JSON_ReleaseKey( JSONNode node )
+{
+  if( node->key != NULL && !( node->flags & JSON_KEY_EXTERNAL ) ) 
   {
-    if( child->type == JSON_TYPE_BRACE ) 
-      child = JSON_FindByKey( child, va_arg( pathArgsList, const char* ) );
-    else if( root->type == JSON_TYPE_BRACKET )
-      child = JSON_FindByIndex( child, va_arg( pathArgsList, long ) );
-    else 
-      break;
-    --pathArgsCount;
+    if( node->flags & JSON_KEY_SHARED ) JSON_ReleaseSharedKey( JSON_GET_SHARED_KEY( node->key ) );
+    else JSON_FreeHeap( node->key, node->keyLength + 1 );
   }
-  va_end( pathArgsList );
-  return child;
+  node->key = NULL;
+  node->keyLength = 0;
+  node->flags &= ~JSON_KEY_SHARED;
 }
 
-char* JSON_GetString( const JSONNode root, int depth )
-{
-  size_t paddingLength = ( depth >= 0 ) ? 2 * depth : 0;               // Padding length for idented mode
-  size_t jsonStringLength = paddingLength;
-  char* jsonString = (char*) malloc( jsonStringLength + 1 );           // Allocate memory for null terminator
-  jsonString[ 0 ] = '\0';
-  for( long indentCount = 0; indentCount < depth; ++indentCount ) 
-    strcat( jsonString, "  " );
-  if( root->key ) 
-  {
-    size_t keyStringLength = strlen( root->key ) + 3;                  // Allocate memory for key string + 2 quotation marks + ':'
-    jsonString = (char*) realloc( jsonString, jsonStringLength + keyStringLength + 1 );
-    sprintf( jsonString + jsonStringLength, "\"%s\":", root->key );    // Copy "<key>" to the end of the string
-    jsonStringLength += keyStringLength;                               // Update total JSON string length
-  }
-  if( root->type == JSON_TYPE_BRACKET || root->type == JSON_TYPE_BRACE ) 
-  {
-    jsonStringLength += 2;
-    jsonString = (char*) realloc( jsonString, jsonStringLength + 1 );  // Allocate memory for 2 brackets/braces
-    strcat( jsonString, root->type == JSON_TYPE_BRACKET? "[" : "{" );  // Add only the first bracket/brace before the child roots                                                     
-    if( root->childrenCount ) 
-    {
-      if( depth >= 0 )                                                 // Append new line between children for idented mode
-      {                                          
-        jsonStringLength++;
-        jsonString = (char*) realloc( jsonString, jsonStringLength + 1 );
-        strcat( jsonString, "\n" );
-      }
-      for( long childIndex = 0; childIndex < (long) root->childrenCount; ++childIndex ) 
-      {
-        // Get already allocated and quoted (if needed) child strings
-        char* childString = JSON_GetString( root->childrenList[ childIndex ], ( depth >= 0 ) ? depth + 1 : -1 ); 
-        jsonStringLength += strlen( childString );
-        jsonString = (char*) realloc( jsonString, jsonStringLength + 1 );
-        strcat( jsonString, childString );
-        free( childString );                                          // Free root string allocated by recursive call
-        if( childIndex + 1 < (long) root->childrenCount )             // Append comma at the end of previous child string
-        {                               
-          jsonStringLength++;
-          jsonString = (char*) realloc( jsonString, jsonStringLength + 1 );
-          strcat( jsonString, "," );
-        }
-        if( depth >= 0 )                                              // Append new line between children for idented mode
-        {                                      
-          jsonStringLength++;
-          jsonString = (char*) realloc( jsonString, jsonStringLength + 1 );
-          strcat( jsonString, "\n" );
-        }
+// Set new key of given node, sharing a single copy among all equal keys read by the parser, 
+// or by all parsers writing to the same arena
+static void JSON_InternKey( JSONParser* parser, JSONNode node, const char* key, size_t keyLength )
+{
+  JSONKeysTable* table = ( parser->arena != NULL ) ? &(parser->arena->keysTable) : &(parser->keysTable);
+  unsigned int hash = JSON_HashKey( key, keyLength );
+  if( 2 * ( table->keysCount + 1 ) > table->slotsCount ) 
+  {
+    size_t slotsCount = ( table->slotsCount > 0 ) ? 2 * table->slotsCount : 64;
+    JSONSharedKey** slots = (JSONSharedKey**) JSON_AllocateHeap( slotsCount * sizeof(JSONSharedKey*) );
+    if( slots != NULL ) 
+    {
+      memset( slots, 0, slotsCount * sizeof(JSONSharedKey*) );
+      for( size_t slot = 0; slot < table->slotsCount; slot++ ) 
+      {
+        JSONSharedKey* sharedKey = table->slots[ slot ];
+        if( sharedKey == NULL ) continue;
+        size_t newSlot = sharedKey->hash & ( slotsCount - 1 );
+        while( slots[ newSlot ] != NULL ) newSlot = ( newSlot + 1 ) & ( slotsCount - 1 );
+        slots[ newSlot ] = sharedKey;
       }
-      jsonStringLength += paddingLength;                              // Pad closing bracket/brace for idented mode
-      jsonString = (char*) realloc( jsonString, jsonStringLength + 1 );
-      for( long indentCount = 0; indentCount < depth; ++indentCount ) 
-        strcat( jsonString, "  " );
+      JSON_FreeHeap( table->slots, table->slotsCount * sizeof(JSONSharedKey*) );
+      table->slots = slots;
+      table->slotsCount = slotsCount;
     }
-    strcat( jsonString, root->type == JSON_TYPE_BRACKET? "]" : "}" ); // Add second bracket/brace after the child roots        
-  } 
-  else 
+  }
+  JSONSharedKey* sharedKey = NULL;
+  size_t slot = 0;
+  if( 2 * ( table->keysCount + 1 ) <= table->slotsCount )   // Keys are copied without sharing if the table could not grow
+  {
+    for( slot = hash & ( table->slotsCount - 1 ); table->slots[ slot ] != NULL; slot = ( slot + 1 ) & ( table->slotsCount - 1 ) ) 
+    {
+      sharedKey = table->slots[ slot ];
+      if( sharedKey->hash == hash && sharedKey->length == keyLength && memcmp( sharedKey->text, key, keyLength ) == 0 ) break;
+      sharedKey = NULL;
+    }
+  }
+  if( sharedKey != NULL ) 
+  {
+    node->key = ( parser->arena != NULL ) ? sharedKey->text : JSON_RetainKey( sharedKey->text );
+  }
+  else
+  {
+    node->key = JSON_CreateKey( parser->arena, key, keyLength, hash );
+    if( node->key != NULL && 2 * ( table->keysCount + 1 ) <= table->slotsCount ) 
+    {
+      sharedKey = JSON_GET_SHARED_KEY( node->key );
+      if( parser->arena == NULL ) sharedKey->referencesCount++;      // Reference of the table, so that it outlives removed nodes
+      table->slots[ slot ] = sharedKey;
+      table->keysCount++;
+    }
+  }
+  if( node->key == NULL ) return;
+  node->keyLength = (unsigned int) keyLength;
+  node->flags |= JSON_KEY_SHARED;
+}
+
+// Forget keys read so far, releasing the references held by the table for heap owned ones
+static void JSON_ClearKeysTable( JSONKeysTable* table, bool isShared )
+{
+  if( table->keysCount == 0 ) return;
+  for( size_t slot = 0; slot < table->slotsCount; slot++ ) 
   {
-    jsonStringLength += strlen( root->value );                        // Allocate memory for value string
-    if( root->type == JSON_TYPE_STRING ) jsonStringLength += 2;       // Allocate memory for 2 quotation marks if needed
-    jsonString = (char*) realloc( jsonString, jsonStringLength + 1 );
-    if( root->type == JSON_TYPE_STRING ) strcat( jsonString, "\"" );
-    strcat( jsonString, root->value );                                // Append value string between quotes (if needed)
-    if( root->type == JSON_TYPE_STRING ) strcat( jsonString, "\"" );
+    if( table->slots[ slot ] != NULL && isShared ) JSON_ReleaseSharedKey( table->slots[ slot ] );
+    table->slots[ slot ] = NULL;
   }
-  jsonString[ jsonStringLength ] = '\0';
-  return jsonString;
+  table->keysCount = 0;
 }
 
-void JSON_Print( const JSONNode root )
+static void JSON_InsertKeySlot( JSONKeyIndex* keyIndex, unsigned int hash, size_t position )
 {
-  char* jsonString = JSON_GetString( root, JSON_FORMAT_IDENT );
-  fputs( jsonString, stdout );
-  free( jsonString );
-  putchar( '\n' );
+  size_t slotMask = keyIndex->slotsCount - 1;
+  size_t slot = hash & slotMask;
+  while( keyIndex->slots[ slot ].position != 0 ) slot = ( slot + 1 ) & slotMask;
+  keyIndex->slots[ slot ].hash = hash;
+  keyIndex->slots[ slot ].position = (unsigned int) position + 1;
+}
+
+static inline size_t JSON_GetKeyIndexSize( size_t slotsCount )
+{
+  return sizeof(JSONKeyIndex) + slotsCount * sizeof(JSONKeySlot);
+}
+
+static void JSON_ReleaseKeyIndex( JSONNode root )
+{
+  if( root->keyIndex != NULL && !( root->flags & JSON_INDEX_EXTERNAL ) ) JSON_FreeHeap( root->keyIndex, JSON_GetKeyIndexSize( root->keyIndex->slotsCount ) );
+  root->keyIndex = NULL;
+}
+
+// Replace key index of given BRACE node by one with room for given number of children
+static void JSON_BuildKeyIndex( JSONArena arena, JSONNode root, size_t childrenCount )
+{
+  size_t slotsCount = 2 * JSON_KEY_INDEX_THRESHOLD;
+  while( slotsCount < 2 * childrenCount ) slotsCount *= 2;
+  JSONKeyIndex* keyIndex = (JSONKeyIndex*) JSON_Allocate( arena, JSON_GetKeyIndexSize( slotsCount ) );
+  if( keyIndex == NULL )                                      // Lookups fall back to linear search, instead of using an outdated index
+  {
+    JSON_ReleaseKeyIndex( root );
+    return;
+  }
+  keyIndex->slotsCount = slotsCount;
+  memset( keyIndex->slots, 0, slotsCount * sizeof(JSONKeySlot) );
+  // Children are inserted in order, so that the first of duplicate keys is found first
+  for( size_t childIndex = 0; childIndex < root->size; childIndex++ ) 
+  {
+    JSONNode child = root->childrenList[ childIndex ];
+    if( child->key != NULL ) JSON_InsertKeySlot( keyIndex, JSON_GetKeyHash( child ), childIndex );
+  }
+  JSON_ReleaseKeyIndex( root );
+  root->keyIndex = keyIndex;
+  root->flags &= ~JSON_INDEX_EXTERNAL;
+  if( arena != NULL ) root->flags |= JSON_INDEX_EXTERNAL;
+}
+
+// Position of the first child with given key (and its hash), or -1 if not found
+static long JSON_FindChildPosition( const JSONNode root, const char* key, size_t keyLength, unsigned int hash )
+{
+  if( root->keyIndex != NULL ) 
+  {
+    size_t slotMask = root->keyIndex->slotsCount - 1;
+    for( size_t slot = hash & slotMask; root->keyIndex->slots[ slot ].position != 0; slot = ( slot + 1 ) & slotMask ) 
+    {
+      JSONKeySlot* keySlot = &(root->keyIndex->slots[ slot ]);
+      if( keySlot->hash != hash ) continue;
+      if( JSON_IsKey( root->childrenList[ keySlot->position - 1 ], key, keyLength ) ) return (long) keySlot->position - 1;
+    }
+    return -1;
+  }
+  for( long childIndex = 0; childIndex < (long) root->size; ++childIndex ) 
+  {
+    if( JSON_IsHashedKey( root->childrenList[ childIndex ], key, keyLength, hash ) )
+      return childIndex;
+  }
+  return -1;
+}
+
+// Index large objects when created or grown, so that lookups never write to the tree
+static inline void JSON_PrepareKeyIndex( JSONArena arena, JSONNode root )
+{
+  if( root->type == JSON_TYPE_BRACE && root->keyIndex == NULL && root->size >= JSON_KEY_INDEX_THRESHOLD && !( root->flags & JSON_FROZEN ) ) 
+    JSON_BuildKeyIndex( arena, root, root->size );
+}
+
+static bool JSON_LoadChildren( JSONNode container );
+
+static JSONNode JSON_FindChild( const JSONNode root, const char* key, size_t keyLength )
+{
+  if( !JSON_LoadChildren( root ) ) return NULL;
+  long position = JSON_FindChildPosition( root, key, keyLength, JSON_HashKey( key, keyLength ) );
+  return ( position >= 0 ) ? root->childrenList[ position ] : NULL;
+}
+
+enum { JSON_READ_INVALID, JSON_READ_INTEGER, JSON_READ_REAL, JSON_READ_UNCONVERTED };
+
+static const double JSON_POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// Validate JSON number syntax, converting it directly when the result is exact without strtod
+static int JSON_ReadNumber( const char* text, size_t length, long long* ref_integer, double* ref_real )
+{
+  const char* end = text + length;
+  bool isNegative = false, isInteger = true, isTruncated = false;
+  unsigned long long mantissa = 0;
+  long exponent = 0;
+  if( text < end && *text == '-' ) 
+  {
+    isNegative = true;
+    text++;
+  }
+  if( text >= end || *text < '0' || *text > '9' ) return JSON_READ_INVALID;
+  if( *text == '0' ) text++;                            // No leading zeros
+  else for( ; text < end && *text >= '0' && *text <= '9'; text++ ) 
+  {
+    if( mantissa <= ( ULLONG_MAX - 9 ) / 10 ) mantissa = 10 * mantissa + ( *text - '0' );
+    else 
+    {
+      exponent++;                                       // Digits beyond 64 bits precision
+      isTruncated = true;
+    }
+  }
+  if( text < end && *text == '.' ) 
+  {
+    isInteger = false;
+    if( ++text >= end || *text < '0' || *text > '9' ) return JSON_READ_INVALID;
+    for( ; text < end && *text >= '0' && *text <= '9'; text++ ) 
+    {
+      if( mantissa <= ( ULLONG_MAX - 9 ) / 10 ) 
+      {
+        mantissa = 10 * mantissa + ( *text - '0' );
+        exponent--;
+      }
+      else isTruncated = true;
+    }
+  }
+  if( text < end && ( *text == 'e' || *text == 'E' ) ) 
+  {
+    isInteger = false;
+    bool isExponentNegative = false;
+    if( ++text < end && ( *text == '+' || *text == '-' ) ) isExponentNegative = ( *(text++) == '-' );
+    if( text >= end || *text < '0' || *text > '9' ) return JSON_READ_INVALID;
+    long exponentValue = 0;
+    for( ; text < end && *text >= '0' && *text <= '9'; text++ )
+      if( exponentValue < 100000 ) exponentValue = 10 * exponentValue + ( *text - '0' );
+    exponent += isExponentNegative ? -exponentValue : exponentValue;
+  }
+  if( text != end ) return JSON_READ_INVALID;
+  // Negative zero is only representable as double
+  if( isInteger && !isTruncated && mantissa <= (unsigned long long) LLONG_MAX + ( isNegative ? 1 : 0 ) && !( isNegative && mantissa == 0 ) ) 
+  {
+    if( ref_integer ) *ref_integer = isNegative ? (long long) ( 0 - mantissa ) : (long long) mantissa;
+    return JSON_READ_INTEGER;
+  }
+  // Both mantissa and power of ten are exact doubles, so a single operation rounds correctly
+  if( !isTruncated && mantissa <= ( 1ull << 53 ) && exponent >= -22 && exponent <= 22 ) 
+  {
+    double real = (double) mantissa;
+    real = ( exponent < 0 ) ? real / JSON_POWERS_OF_TEN[ -exponent ] : real * JSON_POWERS_OF_TEN[ exponent ];
+    if( ref_real ) *ref_real = isNegative ? -real : real;
+    return JSON_READ_REAL;
+  }
+  return JSON_READ_UNCONVERTED;
+}
+
+// Convert text of NUMBER node to binary, without changing the node. Returns JSON_READ_INVALID with zero for invalid text, 
+// and JSON_READ_UNCONVERTED when the conversion needs strtod but it is not forced (or there is no memory for it)
+static int JSON_ConvertNumber( const JSONNode node, bool isConversionForced, long long* ref_integer, double* ref_real )
+{
+  *ref_integer = 0;
+  *ref_real = 0.0;
+  int numberClass = JSON_ReadNumber( node->value, (size_t) node->size, ref_integer, ref_real );
+  if( numberClass != JSON_READ_INTEGER && numberClass != JSON_READ_REAL ) *ref_real = 0.0;
+  if( numberClass == JSON_READ_UNCONVERTED && isConversionForced ) 
+  {
+    char numberBuffer[ 64 ];
+    char* numberString = ( node->size < sizeof(numberBuffer) ) ? numberBuffer : (char*) JSON_AllocateHeap( (size_t) node->size + 1 );
+    if( numberString == NULL ) return JSON_READ_UNCONVERTED;
+    memcpy( numberString, node->value, (size_t) node->size );
+    numberString[ node->size ] = '\0';
+    *ref_real = strtod( numberString, NULL );
+    if( numberString != numberBuffer ) JSON_FreeHeap( numberString, (size_t) node->size + 1 );
+    numberClass = JSON_READ_REAL;
+  }
+  return numberClass;
+}
+
+// Keep binary value of NUMBER node of given conversion class, if it was converted
+static inline void JSON_StoreNumber( JSONNode node, int numberClass, long long integer, double real )
+{
+  node->flags &= ~( JSON_NUMBER_CACHED | JSON_NUMBER_INTEGER );
+  if( numberClass == JSON_READ_INTEGER ) 
+  {
+    node->integer = integer;
+    node->flags |= JSON_NUMBER_CACHED | JSON_NUMBER_INTEGER;
+  }
+  else if( numberClass == JSON_READ_REAL ) 
+  {
+    node->number = real;
+    node->flags |= JSON_NUMBER_CACHED;
+  }
+}
+
+// Update binary value of NUMBER node from its text, returning false if the text is not a valid number
+static bool JSON_CacheNumber( JSONNode node, bool isConversionForced )
+{
+  long long integer;
+  double real;
+  int numberClass = JSON_ConvertNumber( node, isConversionForced, &integer, &real );
+  if( numberClass == JSON_READ_UNCONVERTED && isConversionForced ) return false;  // Left uncached, so that conversion is tried again on next read
+  // Invalid text is cached as 0 when forced, so that it is not read again
+  JSON_StoreNumber( node, ( numberClass == JSON_READ_INVALID && isConversionForced ) ? JSON_READ_REAL : numberClass, integer, real );
+  return ( numberClass != JSON_READ_INVALID );
+}
+
+static size_t JSON_FormatInteger( char* buffer, long long integer )
+{
+  char digits[ 24 ];
+  size_t digitsCount = 0, length = 0;
+  unsigned long long magnitude = ( integer < 0 ) ? 0 - (unsigned long long) integer : (unsigned long long) integer;
+  do digits[ digitsCount++ ] = (char) ( '0' + magnitude % 10 ); while( ( magnitude /= 10 ) > 0 );
+  if( integer < 0 ) buffer[ length++ ] = '-';
+  while( digitsCount > 0 ) buffer[ length++ ] = digits[ --digitsCount ];
+  buffer[ length ] = '\0';
+  return length;
+}
+
+// Binary floating point number f * 2^e, with 64 bits significand
+typedef struct _JSONDiyFloat
+{
+  uint64_t significand;
+  int exponent;
+}
+JSONDiyFloat;
+
+// Normalized powers of ten 10^k for k = -348, -340, ..., 340, rounded to nearest. Enough to scale any double (or float) by Grisu
+static const struct { uint64_t significand; short binaryExponent, decimalExponent; } JSON_CACHED_POWERS[] = 
+{
+  { 0xfa8fd5a0081c0288ull, -1220, -348 }, { 0xbaaee17fa23ebf76ull, -1193, -340 }, { 0x8b16fb203055ac76ull, -1166, -332 },
+  { 0xcf42894a5dce35eaull, -1140, -324 }, { 0x9a6bb0aa55653b2dull, -1113, -316 }, { 0xe61acf033d1a45dfull, -1087, -308 },
+  { 0xab70fe17c79ac6caull, -1060, -300 }, { 0xff77b1fcbebcdc4full, -1034, -292 }, { 0xbe5691ef416bd60cull, -1007, -284 },
+  { 0x8dd01fad907ffc3cull, -980, -276 }, { 0xd3515c2831559a83ull, -954, -268 }, { 0x9d71ac8fada6c9b5ull, -927, -260 },
+  { 0xea9c227723ee8bcbull, -901, -252 }, { 0xaecc49914078536dull, -874, -244 }, { 0x823c12795db6ce57ull, -847, -236 },
+  { 0xc21094364dfb5637ull, -821, -228 }, { 0x9096ea6f3848984full, -794, -220 }, { 0xd77485cb25823ac7ull, -768, -212 },
+  { 0xa086cfcd97bf97f4ull, -741, -204 }, { 0xef340a98172aace5ull, -715, -196 }, { 0xb23867fb2a35b28eull, -688, -188 },
+  { 0x84c8d4dfd2c63f3bull, -661, -180 }, { 0xc5dd44271ad3cdbaull, -635, -172 }, { 0x936b9fcebb25c996ull, -608, -164 },
+  { 0xdbac6c247d62a584ull, -582, -156 }, { 0xa3ab66580d5fdaf6ull, -555, -148 }, { 0xf3e2f893dec3f126ull, -529, -140 },
+  { 0xb5b5ada8aaff80b8ull, -502, -132 }, { 0x87625f056c7c4a8bull, -475, -124 }, { 0xc9bcff6034c13053ull, -449, -116 },
+  { 0x964e858c91ba2655ull, -422, -108 }, { 0xdff9772470297ebdull, -396, -100 }, { 0xa6dfbd9fb8e5b88full, -369, -92 },
+  { 0xf8a95fcf88747d94ull, -343, -84 }, { 0xb94470938fa89bcfull, -316, -76 }, { 0x8a08f0f8bf0f156bull, -289, -68 },
+  { 0xcdb02555653131b6ull, -263, -60 }, { 0x993fe2c6d07b7facull, -236, -52 }, { 0xe45c10c42a2b3b06ull, -210, -44 },
+  { 0xaa242499697392d3ull, -183, -36 }, { 0xfd87b5f28300ca0eull, -157, -28 }, { 0xbce5086492111aebull, -130, -20 },
+  { 0x8cbccc096f5088ccull, -103, -12 }, { 0xd1b71758e219652cull, -77, -4 }, { 0x9c40000000000000ull, -50, 4 },
+  { 0xe8d4a51000000000ull, -24, 12 }, { 0xad78ebc5ac620000ull, 3, 20 }, { 0x813f3978f8940984ull, 30, 28 },
+  { 0xc097ce7bc90715b3ull, 56, 36 }, { 0x8f7e32ce7bea5c70ull, 83, 44 }, { 0xd5d238a4abe98068ull, 109, 52 },
+  { 0x9f4f2726179a2245ull, 136, 60 }, { 0xed63a231d4c4fb27ull, 162, 68 }, { 0xb0de65388cc8ada8ull, 189, 76 },
+  { 0x83c7088e1aab65dbull, 216, 84 }, { 0xc45d1df942711d9aull, 242, 92 }, { 0x924d692ca61be758ull, 269, 100 },
+  { 0xda01ee641a708deaull, 295, 108 }, { 0xa26da3999aef774aull, 322, 116 }, { 0xf209787bb47d6b85ull, 348, 124 },
+  { 0xb454e4a179dd1877ull, 375, 132 }, { 0x865b86925b9bc5c2ull, 402, 140 }, { 0xc83553c5c8965d3dull, 428, 148 },
+  { 0x952ab45cfa97a0b3ull, 455, 156 }, { 0xde469fbd99a05fe3ull, 481, 164 }, { 0xa59bc234db398c25ull, 508, 172 },
+  { 0xf6c69a72a3989f5cull, 534, 180 }, { 0xb7dcbf5354e9beceull, 561, 188 }, { 0x88fcf317f22241e2ull, 588, 196 },
+  { 0xcc20ce9bd35c78a5ull, 614, 204 }, { 0x98165af37b2153dfull, 641, 212 }, { 0xe2a0b5dc971f303aull, 667, 220 },
+  { 0xa8d9d1535ce3b396ull, 694, 228 }, { 0xfb9b7cd9a4a7443cull, 720, 236 }, { 0xbb764c4ca7a44410ull, 747, 244 },
+  { 0x8bab8eefb6409c1aull, 774, 252 }, { 0xd01fef10a657842cull, 800, 260 }, { 0x9b10a4e5e9913129ull, 827, 268 },
+  { 0xe7109bfba19c0c9dull, 853, 276 }, { 0xac2820d9623bf429ull, 880, 284 }, { 0x80444b5e7aa7cf85ull, 907, 292 },
+  { 0xbf21e44003acdd2dull, 933, 300 }, { 0x8e679c2f5e44ff8full, 960, 308 }, { 0xd433179d9c8cb841ull, 986, 316 },
+  { 0x9e19db92b4e31ba9ull, 1013, 324 }, { 0xeb96bf6ebadf77d9ull, 1039, 332 }, { 0xaf87023b9bf0ee6bull, 1066, 340 }
+};
+
+#define JSON_CACHED_POWERS_OFFSET     348     // Minus decimal exponent of first cached power
+#define JSON_CACHED_POWERS_DISTANCE   8       // Decimal exponent step between cached powers
+
+// ceil( exponent * log10( 2 ) ) for |exponent| <= 1650, without floating point (78913 / 2^18 approximating log10( 2 ))
+static inline int JSON_GetDecimalExponent( int exponent )
+{
+  return ( exponent > 0 ) ? ( ( exponent * 78913 ) >> 18 ) + 1 : -( ( -exponent * 78913 ) >> 18 );
+}
+
+// Upper 64 bits of the 128 bits product, rounded
+static JSONDiyFloat JSON_MultiplyDiyFloats( JSONDiyFloat x, JSONDiyFloat y )
+{
+  uint64_t a = x.significand >> 32, b = x.significand & 0xFFFFFFFF;
+  uint64_t c = y.significand >> 32, d = y.significand & 0xFFFFFFFF;
+  uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  uint64_t middle = ( bd >> 32 ) + ( ad & 0xFFFFFFFF ) + ( bc & 0xFFFFFFFF ) + ( 1ull << 31 );
+  return (JSONDiyFloat) { ac + ( ad >> 32 ) + ( bc >> 32 ) + ( middle >> 32 ), x.exponent + y.exponent + 64 };
+}
+
+static JSONDiyFloat JSON_NormalizeDiyFloat( JSONDiyFloat x )
+{
+  while( !( x.significand & 0xFFC0000000000000ull ) ) 
+  {
+    x.significand <<= 10;
+    x.exponent -= 10;
+  }
+  while( !( x.significand & 0x8000000000000000ull ) ) 
+  {
+    x.significand <<= 1;
+    x.exponent--;
+  }
+  return x;
+}
+
+// Decrement last digit while the number gets closer to w, then check that the result is closest and inside the safe interval (Grisu3).
+// Distances are in units of the scaled values, where ulp is the error bound of each of them
+static bool JSON_RoundWeedDigits( char* digits, size_t digitsCount, uint64_t distanceHighW, uint64_t unsafeInterval, uint64_t rest, uint64_t tenKappa, uint64_t ulp )
+{
+  uint64_t smallDistance = distanceHighW - ulp, bigDistance = distanceHighW + ulp;
+  while( rest < smallDistance && unsafeInterval - rest >= tenKappa && 
+         ( rest + tenKappa < smallDistance || smallDistance - rest >= rest + tenKappa - smallDistance ) ) 
+  {
+    digits[ digitsCount - 1 ]--;
+    rest += tenKappa;
+  }
+  // Another candidate could be closer to the real value of w: undecidable at this precision
+  if( rest < bigDistance && unsafeInterval - rest >= tenKappa && 
+      ( rest + tenKappa < bigDistance || bigDistance - rest > rest + tenKappa - bigDistance ) ) return false;
+  return ( 2 * ulp <= rest && rest <= unsafeInterval - 4 * ulp );
+}
+
+// Shortest digits of f * 2^e inside its rounding interval, with 64 bits arithmetic (Grisu3). Returns 0 for the few numbers 
+// where shortness or rounding cannot be guaranteed, otherwise the digits count, with the value being digits * 10^exponent
+static size_t JSON_GetFastDigits( uint64_t significand, int exponent, bool isLowerCloser, char* digits, int* ref_exponent )
+{
+  JSONDiyFloat w = JSON_NormalizeDiyFloat( (JSONDiyFloat) { significand, exponent } );
+  JSONDiyFloat high = JSON_NormalizeDiyFloat( (JSONDiyFloat) { 2 * significand + 1, exponent - 1 } );
+  JSONDiyFloat low = isLowerCloser ? (JSONDiyFloat) { 4 * significand - 1, exponent - 2 } : (JSONDiyFloat) { 2 * significand - 1, exponent - 1 };
+  low.significand <<= low.exponent - high.exponent;
+  low.exponent = high.exponent;
+  // Power of ten that brings the exponent of scaled values to [-60,-32], so that their integral part fits in 32 bits
+  int minExponent = -60 - ( w.exponent + 64 );
+  int powerIndex = ( JSON_CACHED_POWERS_OFFSET + JSON_GetDecimalExponent( minExponent + 63 ) - 1 ) / JSON_CACHED_POWERS_DISTANCE + 1;
+  JSONDiyFloat tenMk = { JSON_CACHED_POWERS[ powerIndex ].significand, JSON_CACHED_POWERS[ powerIndex ].binaryExponent };
+  w = JSON_MultiplyDiyFloats( w, tenMk );
+  low = JSON_MultiplyDiyFloats( low, tenMk );
+  high = JSON_MultiplyDiyFloats( high, tenMk );
+  // Scaled values are off by at most one ulp, so that the unsafe interval contains the real one
+  uint64_t ulp = 1;
+  uint64_t tooHigh = high.significand + ulp, unsafeInterval = tooHigh - ( low.significand - ulp );
+  int shift = -w.exponent;
+  uint64_t one = 1ull << shift;
+  uint32_t integrals = (uint32_t) ( tooHigh >> shift );
+  uint64_t fractionals = tooHigh & ( one - 1 );
+  uint32_t divisor = 1;
+  int kappa = 0;
+  while( kappa < 10 && integrals >= divisor ) 
+  {
+    kappa++;
+    if( kappa < 10 ) divisor *= 10;
+  }
+  if( kappa < 10 ) divisor /= 10;
+  size_t digitsCount = 0;
+  bool isValid = false;
+  while( kappa > 0 ) 
+  {
+    digits[ digitsCount++ ] = (char) ( '0' + integrals / divisor );
+    integrals %= divisor;
+    kappa--;
+    uint64_t rest = ( (uint64_t) integrals << shift ) + fractionals;
+    if( rest < unsafeInterval ) 
+    {
+      isValid = JSON_RoundWeedDigits( digits, digitsCount, tooHigh - w.significand, unsafeInterval, rest, (uint64_t) divisor << shift, ulp );
+      *ref_exponent = -( JSON_CACHED_POWERS[ powerIndex ].decimalExponent ) + kappa;
+      return isValid ? digitsCount : 0;
+    }
+    divisor /= 10;
+  }
+  while( true ) 
+  {
+    fractionals *= 10;
+    ulp *= 10;
+    unsafeInterval *= 10;
+    digits[ digitsCount++ ] = (char) ( '0' + ( fractionals >> shift ) );
+    fractionals &= one - 1;
+    kappa--;
+    if( fractionals < unsafeInterval ) 
+    {
+      isValid = JSON_RoundWeedDigits( digits, digitsCount, ( tooHigh - w.significand ) * ulp, unsafeInterval, fractionals, one, ulp );
+      *ref_exponent = -( JSON_CACHED_POWERS[ powerIndex ].decimalExponent ) + kappa;
+      return isValid ? digitsCount : 0;
+    }
+  }
+}
+
+#define JSON_BIGNUM_MAX_LIMBS   40      // 1280 bits: doubles scaled by powers of ten up to their extreme exponents
+
+typedef struct _JSONBignum
+{
+  uint32_t limbs[ JSON_BIGNUM_MAX_LIMBS ];      // Little endian
+  size_t limbsCount;
+}
+JSONBignum;
+
+static void JSON_SetBignum( JSONBignum* number, uint64_t value )
+{
+  number->limbsCount = 0;
+  for( ; value > 0; value >>= 32 ) number->limbs[ number->limbsCount++ ] = (uint32_t) value;
+}
+
+static void JSON_MultiplyBignum( JSONBignum* number, uint32_t factor )
+{
+  uint64_t carry = 0;
+  for( size_t limbIndex = 0; limbIndex < number->limbsCount; limbIndex++ ) 
+  {
+    carry += (uint64_t) number->limbs[ limbIndex ] * factor;
+    number->limbs[ limbIndex ] = (uint32_t) carry;
+    carry >>= 32;
+  }
+  if( carry > 0 ) number->limbs[ number->limbsCount++ ] = (uint32_t) carry;
+}
+
+static void JSON_MultiplyBignumByPowerOf10( JSONBignum* number, int exponent )
+{
+  for( ; exponent >= 9; exponent -= 9 ) JSON_MultiplyBignum( number, 1000000000 );
+  for( ; exponent > 0; exponent-- ) JSON_MultiplyBignum( number, 10 );
+}
+
+static void JSON_ShiftBignum( JSONBignum* number, int bitsCount )
+{
+  if( number->limbsCount == 0 ) return;
+  size_t limbsShift = (size_t) bitsCount / 32;
+  bitsCount %= 32;
+  number->limbs[ number->limbsCount ] = 0;
+  for( size_t limbIndex = number->limbsCount + 1; limbIndex > 0; limbIndex-- ) 
+  {
+    uint32_t limb = ( limbIndex <= number->limbsCount ) ? number->limbs[ limbIndex - 1 ] : 0;
+    uint32_t lowerLimb = ( limbIndex >= 2 ) ? number->limbs[ limbIndex - 2 ] : 0;
+    number->limbs[ limbIndex - 1 + limbsShift ] = ( bitsCount > 0 ) ? ( limb << bitsCount ) | ( lowerLimb >> ( 32 - bitsCount ) ) : limb;
+  }
+  for( size_t limbIndex = 0; limbIndex < limbsShift; limbIndex++ ) number->limbs[ limbIndex ] = 0;
+  number->limbsCount += limbsShift + 1;
+  while( number->limbsCount > 0 && number->limbs[ number->limbsCount - 1 ] == 0 ) number->limbsCount--;
+}
+
+static void JSON_AddBignums( JSONBignum* result, const JSONBignum* a, const JSONBignum* b )
+{
+  uint64_t carry = 0;
+  size_t limbsCount = ( a->limbsCount > b->limbsCount ) ? a->limbsCount : b->limbsCount;
+  for( size_t limbIndex = 0; limbIndex < limbsCount; limbIndex++ ) 
+  {
+    carry += ( limbIndex < a->limbsCount ) ? a->limbs[ limbIndex ] : 0;
+    carry += ( limbIndex < b->limbsCount ) ? b->limbs[ limbIndex ] : 0;
+    result->limbs[ limbIndex ] = (uint32_t) carry;
+    carry >>= 32;
+  }
+  result->limbsCount = limbsCount;
+  if( carry > 0 ) result->limbs[ result->limbsCount++ ] = (uint32_t) carry;
+}
+
+// Subtract smaller or equal number b from a
+static void JSON_SubtractBignum( JSONBignum* a, const JSONBignum* b )
+{
+  int64_t borrow = 0;
+  for( size_t limbIndex = 0; limbIndex < a->limbsCount; limbIndex++ ) 
+  {
+    borrow += (int64_t) a->limbs[ limbIndex ] - ( ( limbIndex < b->limbsCount ) ? b->limbs[ limbIndex ] : 0 );
+    a->limbs[ limbIndex ] = (uint32_t) borrow;
+    borrow = ( borrow < 0 ) ? -1 : 0;
+  }
+  while( a->limbsCount > 0 && a->limbs[ a->limbsCount - 1 ] == 0 ) a->limbsCount--;
+}
+
+static int JSON_CompareBignums( const JSONBignum* a, const JSONBignum* b )
+{
+  if( a->limbsCount != b->limbsCount ) return ( a->limbsCount > b->limbsCount ) ? 1 : -1;
+  for( size_t limbIndex = a->limbsCount; limbIndex > 0; limbIndex-- ) 
+  {
+    if( a->limbs[ limbIndex - 1 ] != b->limbs[ limbIndex - 1 ] ) return ( a->limbs[ limbIndex - 1 ] > b->limbs[ limbIndex - 1 ] ) ? 1 : -1;
+  }
+  return 0;
+}
+
+// Shortest digits of f * 2^e inside its rounding interval, with exact arithmetic (Steele & White, Burger & Dybvig). 
+// Interval ends are included for even significands, as they read back to the same number with round half to even
+static size_t JSON_GetExactDigits( uint64_t significand, int exponent, bool isLowerCloser, char* digits, int* ref_exponent )
+{
+  bool isEven = !( significand & 1 );
+  // Value is remainder / scale, its interval ends being half the distance to its neighbours: highMargin / scale and lowMargin / scale
+  JSONBignum remainder, scale, highMargin, lowMargin, sum;
+  JSON_SetBignum( &remainder, significand );
+  JSON_ShiftBignum( &remainder, 2 + ( ( exponent > 0 ) ? exponent : 0 ) );
+  JSON_SetBignum( &scale, 1 );
+  JSON_ShiftBignum( &scale, 2 - ( ( exponent < 0 ) ? exponent : 0 ) );
+  JSON_SetBignum( &highMargin, 1 );
+  JSON_ShiftBignum( &highMargin, 1 + ( ( exponent > 0 ) ? exponent : 0 ) );
+  JSON_SetBignum( &lowMargin, 1 );
+  JSON_ShiftBignum( &lowMargin, ( isLowerCloser ? 0 : 1 ) + ( ( exponent > 0 ) ? exponent : 0 ) );
+  // Estimate never above ceil( log10( value ) ), and corrected upwards
+  int bitsCount = 0;
+  while( bitsCount < 64 && ( significand >> bitsCount ) > 0 ) bitsCount++;
+  int decimalExponent = JSON_GetDecimalExponent( bitsCount + exponent - 1 );
+  if( decimalExponent >= 0 ) JSON_MultiplyBignumByPowerOf10( &scale, decimalExponent );
+  else 
+  {
+    JSON_MultiplyBignumByPowerOf10( &remainder, -decimalExponent );
+    JSON_MultiplyBignumByPowerOf10( &highMargin, -decimalExponent );
+    JSON_MultiplyBignumByPowerOf10( &lowMargin, -decimalExponent );
+  }
+  while( true ) 
+  {
+    JSON_AddBignums( &sum, &remainder, &highMargin );
+    int comparison = JSON_CompareBignums( &sum, &scale );
+    if( comparison < 0 || ( comparison == 0 && !isEven ) ) break;
+    JSON_MultiplyBignum( &scale, 10 );
+    decimalExponent++;
+  }
+  size_t digitsCount = 0;
+  while( true ) 
+  {
+    JSON_MultiplyBignum( &remainder, 10 );
+    JSON_MultiplyBignum( &highMargin, 10 );
+    JSON_MultiplyBignum( &lowMargin, 10 );
+    char digit = '0';
+    for( ; JSON_CompareBignums( &remainder, &scale ) >= 0; digit++ ) JSON_SubtractBignum( &remainder, &scale );
+    int lowComparison = JSON_CompareBignums( &remainder, &lowMargin );
+    JSON_AddBignums( &sum, &remainder, &highMargin );
+    int highComparison = JSON_CompareBignums( &sum, &scale );
+    bool isLowEnd = ( lowComparison < 0 || ( lowComparison == 0 && isEven ) );
+    bool isHighEnd = ( highComparison > 0 || ( highComparison == 0 && isEven ) );
+    decimalExponent--;
+    if( isLowEnd && isHighEnd )                                     // Both candidates read back the same: take the closest one
+    {
+      JSON_AddBignums( &sum, &remainder, &remainder );
+      int comparison = JSON_CompareBignums( &sum, &scale );
+      if( comparison > 0 || ( comparison == 0 && ( digit & 1 ) ) ) digit++;
+    }
+    else if( isHighEnd ) digit++;
+    digits[ digitsCount++ ] = digit;
+    if( isLowEnd || isHighEnd ) break;
+  }
+  *ref_exponent = decimalExponent;
+  return digitsCount;
+}
+
+// Write shortest text that reads back to the same binary number f * 2^e, in the notation of printf "%g"
+static size_t JSON_FormatShortest( char* buffer, bool isNegative, uint64_t significand, int exponent, bool isLowerCloser )
+{
+  char digits[ 20 ];
+  int decimalExponent = 0;
+  size_t length = 0, digitsCount = 0;
+  if( isNegative ) buffer[ length++ ] = '-';
+  if( significand == 0 ) 
+  {
+    buffer[ length++ ] = '0';
+    buffer[ length ] = '\0';
+    return length;
+  }
+  digitsCount = JSON_GetFastDigits( significand, exponent, isLowerCloser, digits, &decimalExponent );
+  if( digitsCount == 0 ) digitsCount = JSON_GetExactDigits( significand, exponent, isLowerCloser, digits, &decimalExponent );
+  int pointPosition = (int) digitsCount + decimalExponent;         // Digits before the decimal point
+  if( pointPosition > -4 && pointPosition <= 15 ) 
+  {
+    if( pointPosition <= 0 ) 
+    {
+      buffer[ length++ ] = '0';
+      buffer[ length++ ] = '.';
+      for( ; pointPosition < 0; pointPosition++ ) buffer[ length++ ] = '0';
+    }
+    for( size_t digitIndex = 0; digitIndex < digitsCount || (int) digitIndex < pointPosition; digitIndex++ ) 
+    {
+      if( pointPosition > 0 && (int) digitIndex == pointPosition ) buffer[ length++ ] = '.';
+      buffer[ length++ ] = ( digitIndex < digitsCount ) ? digits[ digitIndex ] : '0';
+    }
+  }
+  else 
+  {
+    buffer[ length++ ] = digits[ 0 ];
+    if( digitsCount > 1 ) buffer[ length++ ] = '.';
+    for( size_t digitIndex = 1; digitIndex < digitsCount; digitIndex++ ) buffer[ length++ ] = digits[ digitIndex ];
+    int scientificExponent = pointPosition - 1;
+    buffer[ length++ ] = 'e';
+    buffer[ length++ ] = ( scientificExponent < 0 ) ? '-' : '+';
+    if( scientificExponent < 0 ) scientificExponent = -scientificExponent;
+    if( scientificExponent < 10 ) buffer[ length++ ] = '0';
+    length += JSON_FormatInteger( buffer + length, scientificExponent );
+  }
+  buffer[ length ] = '\0';
+  return length;
+}
+
+// Write shortest representation that reads back to the same double, independently of locale. Buffer must hold JSON_NUMBER_MAX_LENGTH chars
+static size_t JSON_FormatNumber( char* buffer, double number )
+{
+  if( isnan( number ) || isinf( number ) ) return (size_t) sprintf( buffer, "%s", NULL_STR );  // Not representable in JSON
+  // Negative zero takes the generic path, so that its sign is kept
+  if( number > -1e15 && number < 1e15 && number == (double) (long long) number && !( number == 0.0 && signbit( number ) ) ) 
+    return JSON_FormatInteger( buffer, (long long) number );
+  uint64_t bits;
+  memcpy( &bits, &number, sizeof(bits) );
+  int biasedExponent = (int) ( ( bits >> 52 ) & 0x7FF );
+  uint64_t fraction = bits & ( ( 1ull << 52 ) - 1 );
+  if( biasedExponent == 0 ) return JSON_FormatShortest( buffer, bits >> 63, fraction, -1074, false );     // Subnormal
+  return JSON_FormatShortest( buffer, bits >> 63, fraction | ( 1ull << 52 ), biasedExponent - 1075, ( fraction == 0 && biasedExponent > 1 ) );
+}
+
+// Write shortest representation that reads back to the same float, which is usually shorter than for the same value as double
+static size_t JSON_FormatFloat( char* buffer, float number )
+{
+  if( isnan( number ) || isinf( number ) || ( number > -1e15f && number < 1e15f && number == (float) (long long) number ) )
+    return JSON_FormatNumber( buffer, number );
+  uint32_t bits;
+  memcpy( &bits, &number, sizeof(bits) );
+  int biasedExponent = (int) ( ( bits >> 23 ) & 0xFF );
+  uint32_t fraction = bits & ( ( 1U << 23 ) - 1 );
+  if( biasedExponent == 0 ) return JSON_FormatShortest( buffer, bits >> 31, fraction, -149, false );
+  return JSON_FormatShortest( buffer, bits >> 31, fraction | ( 1U << 23 ), biasedExponent - 150, ( fraction == 0 && biasedExponent > 1 ) );
+}
+
+static size_t JSON_FormatCachedNumber( const JSONNode node, char* buffer )
+{
+  if( node->flags & JSON_NUMBER_INTEGER ) return JSON_FormatInteger( buffer, node->integer );
+  return JSON_FormatNumber( buffer, node->number );
+}
+
+static bool JSON_PushChild( JSONParser* parser, JSONNode child )
+{
+  if( parser->childrenStackLength >= parser->childrenStackSize )
+  {
+    size_t stackSize = ( parser->childrenStackSize > 0 ) ? 2 * parser->childrenStackSize : 64;
+    JSONNode* childrenStack = (JSONNode*) JSON_ResizeHeap( parser->childrenStack, parser->childrenStackSize * sizeof(JSONNode), stackSize * sizeof(JSONNode) );
+    if( childrenStack == NULL ) return false;
+    parser->childrenStack = childrenStack;
+    parser->childrenStackSize = stackSize;
+  }
+  parser->childrenStack[ parser->childrenStackLength++ ] = child;
+  return true;
+}
+
+// Move collected children to a list allocated once with the final size. On failure, they are left in the children stack
+static bool JSON_CloseContainer( JSONParser* parser, JSONNode root, size_t stackBase )
+{
+  size_t childrenCount = parser->childrenStackLength - stackBase;
+  root->size = root->capacity = 0;
+  root->childrenList = NULL;
+  if( childrenCount > 0 )
+  {
+    root->childrenList = (JSONNode*) JSON_Allocate( parser->arena, childrenCount * sizeof(JSONNode) );
+    if( root->childrenList == NULL ) return false;
+    root->size = root->capacity = childrenCount;
+    memcpy( root->childrenList, parser->childrenStack + stackBase, (size_t) root->size * sizeof(JSONNode) );
+    for( size_t childIndex = 0; childIndex < root->size; childIndex++ )
+      root->childrenList[ childIndex ]->parent = root;
+  }
+  parser->childrenStackLength = stackBase;
+  JSON_PrepareKeyIndex( parser->arena, root );
+  return true;
+}
+
+// Element being read, with key and value referencing the parsed text
+typedef struct _JSONElement
+{
+  const char* key;                    // NULL if there is none, or if it is not kept (for array items)
+  size_t keyLength;
+  const char* value;                  // Scalar value, or source text of containers to be read on first access
+  size_t length;
+  enum JSONNodeType type;
+  const char* literal;                // Constant string of null and boolean values
+  int numberClass;                    // Binary value of numbers, converted while validating them when exact
+  long long integer;
+  double real;
+  bool hasKey, hasValue, isClosed;
+}
+JSONElement;
+
+// Output of the parser, receiving elements once their values are known (keys come with them)
+typedef struct _JSONParserSink
+{
+  int (*addValue)( void* output, const JSONElement* element );          // Scalars and containers read on first access
+  int (*openContainer)( void* output, const JSONElement* element );
+  int (*closeContainer)( void* output );
+}
+JSONParserSink;
+
+static inline void JSON_ResetElement( JSONElement* element )
+{
+  element->key = NULL;
+  element->hasKey = element->hasValue = element->isClosed = false;
+}
+
+// Validate element value when it ends. Elements without value are discarded
+static inline int JSON_EndElement( JSONElement* element, const JSONParserSink* sink, void* output )
+{
+  if( !element->hasValue ) return JSON_OK;
+  if( element->type == JSON_TYPE_NUMBER ) 
+  {
+    element->numberClass = JSON_ReadNumber( element->value, element->length, &(element->integer), &(element->real) );
+    if( element->numberClass == JSON_READ_INVALID ) return JSON_ERROR_INVALID_NUMBER;
+  }
+  return ( sink != NULL ) ? sink->addValue( output, element ) : JSON_OK;
+}
+
+static const char* JSON_SkipContainer( const JSONScanner* scanner, const char* data, const char* end )
+{
+  char opening = *data;
+  size_t depth = 0;
+  while( data < end ) 
+  {
+    char c = *(data++);
+    if( c == '"' || c == '\'' ) 
+    {
+      data = scanner->findStringEnd( data, end, c );
+      if( data >= end ) return NULL;
+      data++;
+    }
+    else if( c == '[' || c == '{' ) depth++;
+    else if( c == ']' || c == '}' ) 
+    {
+      if( --depth > 0 ) continue;
+      return ( c == ( ( opening == '[' ) ? ']' : '}' ) ) ? data : NULL;
+    }
+  }
+  return NULL;
+}
+
+// Read elements of nested containers with an explicit stack instead of recursion, so that depth is limited only by memory (or maxDepth).
+// This grammar is shared by all parsers producing whole documents, which only differ in their output
+static int JSON_ParseElements( JSONParser* parser, const JSONParserSink* sink, void* output, const char** ref_data )
+{
+  const char* data = *ref_data;
+  const char* end = parser->end;
+  JSONElement element, pendingContainer;
+  size_t pendingDepth = 0;                    // Depth of container validated for reading on first access, whose elements don't reach the output
+  int error = JSON_OK;
+  JSON_ResetElement( &element );
+  parser->depth = 0;
+  while( error == JSON_OK ) 
+  {
+    data = JSON_SkipSpaces( parser->scanner, data, end );
+    if( data >= end ) 
+    {
+      if( parser->depth > 0 ) error = JSON_ERROR_UNEXPECTED;   // Missing closing delimiter
+      break;
+    }
+    char c = *data;
+    if( c == ',' || c == ']' || c == '}' ) 
+    {
+      if( parser->depth == 0 ) break;                         // End of top level element
+      error = JSON_EndElement( &element, ( pendingDepth > 0 ) ? NULL : sink, output );
+      if( error != JSON_OK ) break;
+      JSON_ResetElement( &element );
+      if( c != ',' ) 
+      {
+        if( c != parser->delimitersStack[ parser->depth - 1 ] ) 
+        {
+          error = JSON_ERROR_UNEXPECTED;
+          break;
+        }
+        parser->depth--;
+        element.isClosed = true;                              // Closed container becomes the element being read
+        if( pendingDepth == 0 ) error = sink->closeContainer( output );
+        else if( parser->depth < pendingDepth ) 
+        {
+          pendingContainer.length = data + 1 - pendingContainer.value;
+          if( pendingContainer.length > UINT_MAX ) error = JSON_ERROR_NO_SPACE;    // Too large to be referenced by its node
+          else error = sink->addValue( output, &pendingContainer );
+          pendingDepth = 0;
+        }
+      }
+      data++;
+    }
+    else if( element.isClosed )                               // Nothing else may follow a closed container
+    {
+      error = JSON_ERROR_UNEXPECTED;
+    }
+    else if( c == '[' || c == '{' ) 
+    {
+      element.type = ( c == '[' ) ? JSON_TYPE_BRACKET : JSON_TYPE_BRACE;
+      element.hasValue = false;                               // Container replaces previous scalar, if any
+      if( parser->isLazy && parser->depth > 0 && pendingDepth == 0 ) 
+      {
+        // Nested container becomes a closed element, with children read from its source on first access
+        element.value = data;
+        if( parser->isChecked ) 
+        {
+          const char* containerEnd = JSON_SkipContainer( parser->scanner, data, end );
+          if( containerEnd == NULL || (size_t) ( containerEnd - data ) > UINT_MAX ) 
+          {
+            error = ( containerEnd == NULL ) ? JSON_ERROR_UNEXPECTED : JSON_ERROR_NO_SPACE;
+            break;
+          }
+          element.length = containerEnd - data;
+          error = sink->addValue( output, &element );
+          JSON_ResetElement( &element );
+          element.isClosed = true;
+          data = containerEnd;
+          continue;
+        }
+        pendingContainer = element;                           // Validated like any other container, without output
+        pendingDepth = parser->depth + 1;
+      }
+      if( parser->maxDepth > 0 && parser->depth >= parser->maxDepth ) 
+      {
+        error = JSON_ERROR_TOO_DEEP;
+        break;
+      }
+      if( parser->depth >= parser->delimitersStackSize )
+      {
+        size_t stackSize = ( parser->delimitersStackSize > 0 ) ? 2 * parser->delimitersStackSize : 64;
+        char* delimitersStack = (char*) JSON_ResizeHeap( parser->delimitersStack, parser->delimitersStackSize, stackSize );
+        if( delimitersStack == NULL ) 
+        {
+          error = JSON_ERROR_NO_SPACE;
+          break;
+        }
+        parser->delimitersStack = delimitersStack;
+        parser->delimitersStackSize = stackSize;
+      }
+      parser->delimitersStack[ parser->depth++ ] = ( c == '[' ) ? ']' : '}';
+      if( pendingDepth == 0 ) error = sink->openContainer( output, &element );
+      JSON_ResetElement( &element );
+      data++;
+    } 
+    else if( c == ':' ) 
+    {
+      if( !element.hasValue ) error = JSON_ERROR_NO_KEY; 
+      else if( element.hasKey ) error = JSON_ERROR_UNEXPECTED; 
+      else
+      {
+        // Keys are kept only for object members and the root
+        bool isMember = ( parser->depth == 0 || parser->delimitersStack[ parser->depth - 1 ] == '}' );
+        element.key = isMember ? element.value : NULL;
+        element.keyLength = element.length;
+        element.hasKey = true;
+        element.hasValue = false;
+        data++;
+      }
+    } 
+    else 
+    {
+      // Value replaces the previous one, if any
+      const char* token = data;
+      element.literal = NULL;
+      if( c == '\'' || c == '"' ) 
+      {
+        data = parser->scanner->findStringEnd( ++token, end, c );
+        if( data >= end )                                     // Missing closing quote
+        {
+          data = token;
+          error = JSON_ERROR_UNEXPECTED;
+          break;
+        }
+        element.type = JSON_TYPE_STRING;
+        element.length = data++ - token;
+      } 
+      else 
+      {
+        data = parser->scanner->findTokenEnd( data, end );
+        element.length = data - token;
+        element.type = JSON_ReadBareToken( token, &(element.length), &(element.literal) );
+      }
+      element.value = token;
+      element.hasValue = true;
+    }
+  }
+  if( error == JSON_OK ) error = JSON_EndElement( &element, sink, output );
+  *ref_data = data;
+  return error;
+}
+
+// Set key of parsed node, referencing it or sharing a single copy among all equal keys
+static bool JSON_SetParsedKey( JSONParser* parser, JSONNode node, const char* key, size_t keyLength )
+{
+  if( parser->sourceMode == JSON_SOURCE_COPY ) 
+  {
+    JSON_InternKey( parser, node, key, keyLength );
+    return ( node->key != NULL );
+  }
+  node->key = (char*) key;
+  node->keyLength = (unsigned int) keyLength;
+  node->flags |= JSON_KEY_EXTERNAL;
+  return true;
+}
+
+// Add complete node to the open container, or make it the root
+static int JSON_AddTreeNode( JSONParser* parser, JSONNode node )
+{
+  if( parser->containersCount == 0 ) parser->root = node;
+  else if( !JSON_PushChild( parser, node ) ) 
+  {
+    JSON_Destroy( node );
+    return JSON_ERROR_NO_SPACE;
+  }
+  return JSON_OK;
+}
+
+static JSONNode JSON_CreateTreeNode( JSONParser* parser, const JSONElement* element )
+{
+  JSONNode node = JSON_CreateNode( parser->arena, element->type );
+  if( node == NULL ) return NULL;
+  if( element->key != NULL && !JSON_SetParsedKey( parser, node, element->key, element->keyLength ) ) 
+  {
+    JSON_Destroy( node );
+    return NULL;
+  }
+  return node;
+}
+
+static int JSON_AddTreeValue( void* output, const JSONElement* element )
+{
+  JSONParser* parser = (JSONParser*) output;
+  JSONNode node = JSON_CreateTreeNode( parser, element );
+  if( node == NULL ) return JSON_ERROR_NO_SPACE;
+  if( JSON_IS_INTERNAL( node ) ) 
+  {
+    node->value = (char*) element->value;
+    node->capacity = (unsigned int) element->length;
+    node->flags |= JSON_CHILDREN_PENDING | JSON_DATA_EXTERNAL;
+  }
+  else if( element->literal != NULL )                         // Literals reference constant strings, without allocation
+  {
+    node->value = (char*) element->literal;
+    node->size = strlen( element->literal );
+    node->flags |= JSON_DATA_EXTERNAL;
+  }
+  else if( !JSON_SetValueSlice( parser, node, element->value, element->length ) ) 
+  {
+    JSON_Destroy( node );
+    return JSON_ERROR_NO_SPACE;
+  }
+  if( node->type == JSON_TYPE_NUMBER ) JSON_StoreNumber( node, element->numberClass, element->integer, element->real );
+  return JSON_AddTreeNode( parser, node );
+}
+
+static int JSON_OpenTreeContainer( void* output, const JSONElement* element )
+{
+  JSONParser* parser = (JSONParser*) output;
+  if( parser->containersCount >= parser->containersStackSize )
+  {
+    size_t stackSize = ( parser->containersStackSize > 0 ) ? 2 * parser->containersStackSize : 32;
+    JSONParserFrame* containersStack = (JSONParserFrame*) JSON_ResizeHeap( parser->containersStack, parser->containersStackSize * sizeof(JSONParserFrame), 
+                                                                           stackSize * sizeof(JSONParserFrame) );
+    if( containersStack == NULL ) return JSON_ERROR_NO_SPACE;
+    parser->containersStack = containersStack;
+    parser->containersStackSize = stackSize;
+  }
+  JSONNode node = JSON_CreateTreeNode( parser, element );
+  if( node == NULL ) return JSON_ERROR_NO_SPACE;
+  parser->containersStack[ parser->containersCount ].container = node;
+  parser->containersStack[ parser->containersCount ].stackBase = parser->childrenStackLength;
+  parser->containersCount++;
+  return JSON_OK;
+}
+
+static int JSON_CloseTreeContainer( void* output )
+{
+  JSONParser* parser = (JSONParser*) output;
+  JSONParserFrame* frame = &(parser->containersStack[ parser->containersCount - 1 ]);
+  // Container is kept open on failure, to be released with the rest of the partial tree
+  if( !JSON_CloseContainer( parser, frame->container, frame->stackBase ) ) return JSON_ERROR_NO_SPACE;
+  parser->containersCount--;
+  return JSON_AddTreeNode( parser, frame->container );
+}
+
+static const JSONParserSink JSON_TREE_SINK = { JSON_AddTreeValue, JSON_OpenTreeContainer, JSON_CloseTreeContainer };
+
+static JSONNode JSON_ParseTree( JSONParser* parser, const char** ref_jsonString, int* error )
+{
+  parser->root = NULL;
+  *error = JSON_ParseElements( parser, &JSON_TREE_SINK, parser, ref_jsonString );
+  if( *error != JSON_OK ) 
+  {
+    // Release partial tree: open containers and children collected for them
+    JSON_Destroy( parser->root );
+    while( parser->containersCount > 0 ) JSON_Destroy( parser->containersStack[ --parser->containersCount ].container );
+    while( parser->childrenStackLength > 0 ) JSON_Destroy( parser->childrenStack[ --parser->childrenStackLength ] );
+    return NULL;
+  }
+  return parser->root;
+}
+
+// Parse keeping scratch stacks allocated, for reuse by following calls
+static JSONNode JSON_ParseText( JSONParser* parser, const char* jsonString, size_t length, JSONErrorInfo* ref_errorInfo )
+{
+  int error;
+  const char* position = jsonString;
+  parser->end = jsonString + length;
+  parser->scanner = JSON_GetScanner();
+  JSONNode root = JSON_ParseTree( parser, &position, &error );
+  if( error == JSON_OK && ( root == NULL || !root->type ) ) 
+  {
+    JSON_Destroy( root );
+    root = NULL;
+    error = JSON_ERROR_NO_VALUE;
+  }
+  if( ref_errorInfo != NULL ) 
+  {
+    ref_errorInfo->code = error;
+    ref_errorInfo->offset = position - jsonString;
+  }
+  return root;
+}
+
+static void JSON_ReleaseParser( JSONParser* parser )
+{
+  JSON_ClearKeysTable( &(parser->keysTable), true );
+  JSON_FreeHeap( parser->keysTable.slots, parser->keysTable.slotsCount * sizeof(JSONSharedKey*) );
+  JSON_FreeHeap( parser->childrenStack, parser->childrenStackSize * sizeof(JSONNode) );
+  JSON_FreeHeap( parser->containersStack, parser->containersStackSize * sizeof(JSONParserFrame) );
+  JSON_FreeHeap( parser->delimitersStack, parser->delimitersStackSize );
+}
+
+static JSONNode JSON_ParseWith( JSONParser* parser, const char* jsonString, size_t length, JSONErrorInfo* ref_errorInfo )
+{
+  unsigned long long startTime = JSON_GetTime();
+  JSONNode root = JSON_ParseText( parser, jsonString, length, ref_errorInfo );
+  JSON_ReleaseParser( parser );
+  JSON_ADD_COUNTER( counters.parseTime, JSON_GetTime() - startTime );
+  return root;
+}
+
+JSONNode JSON_Parse( const char *jsonString )
+{
+  JSONParser parser = { .arena = NULL, .sourceMode = JSON_SOURCE_COPY };
+  return JSON_ParseWith( &parser, jsonString, strlen( jsonString ), NULL );
+}
+
+JSONNode JSON_ParseN( const char* jsonData, size_t length )
+{
+  if( jsonData == NULL ) return NULL;
+  JSONParser parser = { .arena = NULL, .sourceMode = JSON_SOURCE_COPY };
+  return JSON_ParseWith( &parser, jsonData, length, NULL );
+}
+
+JSONNode JSON_ParseEx( const char* jsonData, size_t length, const JSONParseOptions* options, JSONErrorInfo* ref_errorInfo )
+{
+  if( jsonData == NULL ) return NULL;
+  JSONParser parser = { .arena = NULL, .sourceMode = JSON_SOURCE_COPY };
+  if( options != NULL ) parser.maxDepth = options->maxDepth;
+  return JSON_ParseWith( &parser, jsonData, length, ref_errorInfo );
+}
+
+JSONNode JSON_ParseFile( const char* filePath )
+{
+  JSONNode root = NULL;
+#ifdef JSON_USE_POSIX
+  int fileDescriptor = open( filePath, O_RDONLY );
+  if( fileDescriptor < 0 ) return NULL;
+  struct stat fileStatus;
+  if( fstat( fileDescriptor, &fileStatus ) == 0 && fileStatus.st_size > 0 )
+  {
+    size_t fileSize = (size_t) fileStatus.st_size;
+    void* fileData = mmap( NULL, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+    if( fileData != MAP_FAILED )
+    {
+      madvise( fileData, fileSize, MADV_SEQUENTIAL );
+      root = JSON_ParseN( (const char*) fileData, fileSize );
+      munmap( fileData, fileSize );
+    }
+  }
+  close( fileDescriptor );
+#else
+  FILE* file = fopen( filePath, "rb" );
+  if( file == NULL ) return NULL;
+  if( fseek( file, 0, SEEK_END ) == 0 )
+  {
+    long fileSize = ftell( file );
+    char* fileData = ( fileSize > 0 ) ? (char*) JSON_AllocateHeap( (size_t) fileSize ) : NULL;
+    rewind( file );
+    if( fileData != NULL && fread( fileData, 1, (size_t) fileSize, file ) == (size_t) fileSize )
+      root = JSON_ParseN( fileData, (size_t) fileSize );
+    JSON_FreeHeap( fileData, (size_t) fileSize );
+  }
+  fclose( file );
+#endif
+  return root;
+}
+
+JSONNode JSON_ParseView( const char* jsonString )
+{
+  JSONParser parser = { .arena = NULL, .sourceMode = JSON_SOURCE_VIEW };
+  return JSON_ParseWith( &parser, jsonString, strlen( jsonString ), NULL );
+}
+
+JSONNode JSON_ParseInSitu( char* jsonString )
+{
+  JSONParser parser = { .arena = NULL, .sourceMode = JSON_SOURCE_IN_SITU };
+  return JSON_ParseWith( &parser, jsonString, strlen( jsonString ), NULL );
+}
+
+JSONNode JSON_ParseLazy( const char* jsonString )
+{
+  JSONParser parser = { .arena = NULL, .sourceMode = JSON_SOURCE_VIEW, .isLazy = true };
+  return JSON_ParseWith( &parser, jsonString, strlen( jsonString ), NULL );
+}
+
+static bool JSON_ReadPendingChildren( JSONNode container )
+{
+  JSONParser parser = { .arena = NULL, .sourceMode = JSON_SOURCE_VIEW, .isLazy = true, .isChecked = true };
+  JSONErrorInfo errorInfo;
+  JSONNode source = JSON_ParseWith( &parser, container->value, container->capacity, &errorInfo );
+  if( errorInfo.code == JSON_ERROR_NO_SPACE ) return false;       // Still pending, to be read again on next access
+  container->flags &= ~( JSON_CHILDREN_PENDING | JSON_DATA_EXTERNAL );
+  JSON_InvalidateOutput( container->parent );         // Written text may change from the verbatim source
+  container->childrenList = NULL;
+  container->capacity = 0;
+  if( source == NULL ) return false;                  // Not expected, as the content was validated when parsed
+  // Take children list of the temporary container
+  container->childrenList = source->childrenList;
+  container->size = source->size;
+  container->capacity = source->capacity;
+  for( size_t childIndex = 0; childIndex < container->size; childIndex++ )
+    container->childrenList[ childIndex ]->parent = container;
+  container->keyIndex = source->keyIndex;
+  source->childrenList = NULL;
+  source->keyIndex = NULL;
+  source->size = source->capacity = 0;
+  JSON_Destroy( source );
+  return true;
+}
+
+// Read children of lazily parsed container, if not done yet
+static bool JSON_LoadChildren( JSONNode container )
+{
+  if( !( container->flags & JSON_CHILDREN_PENDING ) ) return true;
+  return JSON_ReadPendingChildren( container );
+}
+
+JSONArena JSON_CreateArena( size_t blockSize )
+{
+  if( blockSize == 0 ) blockSize = JSON_ARENA_BLOCK_SIZE;
+  JSONArena newArena = (JSONArena) JSON_AllocateHeap( sizeof(JSONArenaData) );
+  if( newArena == NULL ) return NULL;
+  newArena->blockSize = blockSize;
+  newArena->keysTable = (JSONKeysTable) { .slots = NULL };
+  newArena->firstBlock = newArena->currentBlock = JSON_CreateArenaBlock( blockSize );
+  if( newArena->firstBlock == NULL )
+  {
+    JSON_FreeHeap( newArena, sizeof(JSONArenaData) );
+    return NULL;
+  }
+  return newArena;
+}
+
+JSONNode JSON_ParseInArena( JSONArena arena, const char* jsonString )
+{
+  if( arena == NULL ) return NULL;
+  JSONParser parser = { .arena = arena, .sourceMode = JSON_SOURCE_COPY };
+  return JSON_ParseWith( &parser, jsonString, strlen( jsonString ), NULL );
+}
+
+void JSON_ResetArena( JSONArena arena )
+{
+  if( arena == NULL ) return;
+  // Blocks are kept for reuse and have their usage reset when reached again
+  arena->currentBlock = arena->firstBlock;
+  arena->firstBlock->used = 0;
+  JSON_ClearKeysTable( &(arena->keysTable), false );     // Its keys are in the memory to be reused
+}
+
+void JSON_DestroyArena( JSONArena arena )
+{
+  if( arena == NULL ) return;
+  JSONArenaBlock* block = arena->firstBlock;
+  while( block != NULL )
+  {
+    JSONArenaBlock* nextBlock = block->next;
+    JSON_FreeHeap( block, JSON_ARENA_HEADER_SIZE + block->size );
+    block = nextBlock;
+  }
+  JSON_FreeHeap( arena->keysTable.slots, arena->keysTable.slotsCount * sizeof(JSONSharedKey*) );
+  JSON_FreeHeap( arena, sizeof(JSONArenaData) );
+}
+
+#define JSON_LINES_CHUNK_SIZE     65536   // Minimum amount of input taken by a worker at once
+#define JSON_LINES_CHUNKS_RATIO   8       // Input is split in at least this number of chunks per worker, for load balancing
+
+typedef struct _JSONLineRecord
+{
+  size_t offset;
+  JSONNode root;
+  int error;
+}
+JSONLineRecord;
+
+// Input and delivery state shared by all workers of a JSON_ParseLines call
+typedef struct _JSONLinesJob
+{
+  const char* buffer;
+  const char* end;
+  const char* nextChunk;                  // Start of the input not taken by any worker yet
+  size_t chunkSize;
+  size_t chunksCount, deliveredChunksCount;
+  bool isOrdered;
+  JSONLineCallback callback;
+  void* userData;
+  int error;                              // Error of the earliest failed record
+  size_t errorOffset;
+#ifdef JSON_USE_THREADS
+  pthread_mutex_t lock;
+  pthread_cond_t chunkDelivered;
+#endif
+}
+JSONLinesJob;
+
+static inline void JSON_LockJob( JSONLinesJob* job )
+{
+#ifdef JSON_USE_THREADS
+  pthread_mutex_lock( &(job->lock) );
+#endif
+}
+
+static inline void JSON_UnlockJob( JSONLinesJob* job )
+{
+#ifdef JSON_USE_THREADS
+  pthread_mutex_unlock( &(job->lock) );
+#endif
+}
+
+// Wait for records of preceding chunks to be delivered by other workers
+static void JSON_WaitForDelivery( JSONLinesJob* job, size_t chunkIndex )
+{
+#ifdef JSON_USE_THREADS
+  JSON_LockJob( job );
+  while( job->deliveredChunksCount != chunkIndex ) pthread_cond_wait( &(job->chunkDelivered), &(job->lock) );
+  JSON_UnlockJob( job );
+#endif
+}
+
+static void JSON_DeliverLine( JSONLinesJob* job, JSONLineRecord* record )
+{
+  if( job->callback != NULL ) job->callback( job->userData, record->offset, record->root, record->error );
+}
+
+// Take chunks of whole lines until input ends, parsing them with own arena and scratch stacks
+static void* JSON_RunLinesWorker( void* jobData )
+{
+  JSONLinesJob* job = (JSONLinesJob*) jobData;
+  JSONArena arena = JSON_CreateArena( 0 );
+  JSONParser parser = { .arena = arena, .sourceMode = JSON_SOURCE_COPY };
+  JSONLineRecord* recordsList = NULL;
+  size_t recordsListSize = 0;
+  int error = JSON_OK;
+  size_t errorOffset = 0;
+  while( arena != NULL ) 
+  {
+    JSON_LockJob( job );
+    const char* chunkStart = job->nextChunk;
+    const char* chunkEnd = job->end;
+    if( (size_t) ( chunkEnd - chunkStart ) > job->chunkSize ) 
+    {
+      chunkEnd = (const char*) memchr( chunkStart + job->chunkSize, '\n', job->end - chunkStart - job->chunkSize );
+      chunkEnd = ( chunkEnd != NULL ) ? chunkEnd + 1 : job->end;
+    }
+    job->nextChunk = chunkEnd;
+    size_t chunkIndex = job->chunksCount++;
+    JSON_UnlockJob( job );
+    if( chunkStart >= chunkEnd ) break;
+    unsigned long long startTime = JSON_GetTime();
+    size_t recordsCount = 0;
+    for( const char* line = chunkStart; line < chunkEnd; ) 
+    {
+      const char* lineEnd = (const char*) memchr( line, '\n', chunkEnd - line );
+      if( lineEnd == NULL ) lineEnd = chunkEnd;
+      if( JSON_SkipSpaces( JSON_GetScanner(), line, lineEnd ) < lineEnd )      // Blank lines are ignored
+      {
+        JSONErrorInfo errorInfo;
+        JSONLineRecord record = { .offset = (size_t) ( line - job->buffer ) };
+        record.root = JSON_ParseText( &parser, line, lineEnd - line, &errorInfo );
+        record.error = errorInfo.code;
+        if( record.error != JSON_OK && ( error == JSON_OK || record.offset < errorOffset ) ) 
+        {
+          error = record.error;
+          errorOffset = record.offset;
+        }
+        if( !job->isOrdered ) JSON_DeliverLine( job, &record );
+        else
+        {
+          if( recordsCount >= recordsListSize ) 
+          {
+            size_t listSize = ( recordsListSize > 0 ) ? 2 * recordsListSize : 256;
+            JSONLineRecord* newList = (JSONLineRecord*) JSON_ResizeHeap( recordsList, recordsListSize * sizeof(JSONLineRecord), listSize * sizeof(JSONLineRecord) );
+            if( newList != NULL ) 
+            {
+              recordsList = newList;
+              recordsListSize = listSize;
+            }
+          }
+          if( recordsCount < recordsListSize ) recordsList[ recordsCount++ ] = record;
+          else if( error == JSON_OK || record.offset < errorOffset )     // Record could not be kept for ordered delivery
+          {
+            error = JSON_ERROR_NO_SPACE;
+            errorOffset = record.offset;
+          }
+        }
+      }
+      line = lineEnd + 1;
+    }
+    JSON_ADD_COUNTER( counters.parseTime, JSON_GetTime() - startTime );
+    if( job->isOrdered ) 
+    {
+      JSON_WaitForDelivery( job, chunkIndex );
+      for( size_t recordIndex = 0; recordIndex < recordsCount; recordIndex++ )
+        JSON_DeliverLine( job, &(recordsList[ recordIndex ]) );
+      JSON_LockJob( job );
+      job->deliveredChunksCount++;
+#ifdef JSON_USE_THREADS
+      pthread_cond_broadcast( &(job->chunkDelivered) );
+#endif
+      JSON_UnlockJob( job );
+    }
+    JSON_ResetArena( arena );
+  }
+  JSON_LockJob( job );
+  if( arena == NULL ) error = JSON_ERROR_NO_SPACE;
+  if( error != JSON_OK && ( job->error == JSON_OK || errorOffset < job->errorOffset ) ) 
+  {
+    job->error = error;
+    job->errorOffset = errorOffset;
+  }
+  JSON_UnlockJob( job );
+  JSON_FreeHeap( recordsList, recordsListSize * sizeof(JSONLineRecord) );
+  JSON_ReleaseParser( &parser );
+  JSON_DestroyArena( arena );
+  return NULL;
+}
+
+int JSON_ParseLines( const char* buffer, size_t length, int threadsCount, bool isOrdered, JSONLineCallback callback, void* userData )
+{
+  if( buffer == NULL ) return JSON_ERROR_NO_VALUE;
+  JSONLinesJob job = { .buffer = buffer, .end = buffer + length, .nextChunk = buffer, .isOrdered = isOrdered, 
+                       .callback = callback, .userData = userData, .error = JSON_OK };
+#ifdef JSON_USE_THREADS
+  if( threadsCount <= 0 ) threadsCount = (int) sysconf( _SC_NPROCESSORS_ONLN );
+  if( threadsCount <= 0 ) threadsCount = 1;
+#else
+  threadsCount = 1;
+#endif
+  job.chunkSize = length / ( (size_t) threadsCount * JSON_LINES_CHUNKS_RATIO );
+  if( job.chunkSize < JSON_LINES_CHUNK_SIZE ) job.chunkSize = JSON_LINES_CHUNK_SIZE;
+#ifdef JSON_USE_THREADS
+  pthread_mutex_init( &(job.lock), NULL );
+  pthread_cond_init( &(job.chunkDelivered), NULL );
+  // Calling thread works too. Workers that fail to start only reduce parallelism
+  pthread_t* threadsList = (pthread_t*) JSON_AllocateHeap( (size_t) threadsCount * sizeof(pthread_t) );
+  int startedThreadsCount = 0;
+  while( threadsList != NULL && startedThreadsCount < threadsCount - 1 ) 
+  {
+    if( pthread_create( &(threadsList[ startedThreadsCount ]), NULL, JSON_RunLinesWorker, &job ) != 0 ) break;
+    startedThreadsCount++;
+  }
+  JSON_RunLinesWorker( &job );
+  for( int threadIndex = 0; threadIndex < startedThreadsCount; threadIndex++ )
+    pthread_join( threadsList[ threadIndex ], NULL );
+  JSON_FreeHeap( threadsList, (size_t) threadsCount * sizeof(pthread_t) );
+  pthread_cond_destroy( &(job.chunkDelivered) );
+  pthread_mutex_destroy( &(job.lock) );
+#else
+  JSON_RunLinesWorker( &job );
+#endif
+  return job.error;
+}
+
+enum { JSON_STREAM_VALUE, JSON_STREAM_STRING, JSON_STREAM_TOKEN, JSON_STREAM_DONE };
+
+// Token referencing the chunk being fed, or copied to its own buffer when it has to outlive it
+typedef struct _JSONStreamToken
+{
+  const char* data;
+  size_t length;
+  char* buffer;
+  size_t bufferSize;
+}
+JSONStreamToken;
+
+struct _JSONStreamData
+{
+  JSONStreamCallbacks callbacks;
+  const JSONScanner* scanner;
+  char* containersStack;                  // Opening delimiter of each open container
+  size_t depth, stackSize;
+  int state, error;
+  char quote;
+  bool isEscaping;                        // Last chunk ended inside an escape sequence
+  bool hasValue, hasKey, hasContainer;    // Parts of the current element read so far
+  bool hasDocument;                       // Top level value found
+  enum JSONNodeType valueType;
+  JSONStreamToken value, key;
+};
+
+static bool JSON_AppendStreamToken( JSONStreamToken* token, const char* data, size_t length )
+{
+  bool isBuffered = ( token->data == token->buffer );
+  if( token->length + length > token->bufferSize )
+  {
+    size_t bufferSize = 2 * ( token->length + length );
+    char* buffer = (char*) JSON_ResizeHeap( token->buffer, token->bufferSize, bufferSize );
+    if( buffer == NULL ) return false;
+    token->buffer = buffer;
+    token->bufferSize = bufferSize;
+  }
+  if( !isBuffered && token->length > 0 ) memcpy( token->buffer, token->data, token->length );
+  if( length > 0 ) memcpy( token->buffer + token->length, data, length );
+  token->data = token->buffer;
+  token->length += length;
+  return true;
+}
+
+// Extend token being read up to given position of current chunk
+static bool JSON_ExtendStreamToken( JSONStreamToken* token, const char* start, const char* stop )
+{
+  if( token->data == token->buffer ) return JSON_AppendStreamToken( token, start, stop - start );
+  token->length = stop - token->data;
+  return true;
+}
+
+static void JSON_EmitStreamKey( JSONStream stream )
+{
+  // Keys are kept only for object members and the root, like in the tree parser
+  bool isMember = ( stream->depth == 0 || stream->containersStack[ stream->depth - 1 ] == '{' );
+  if( stream->hasKey && isMember && stream->callbacks.key != NULL ) 
+    stream->callbacks.key( stream->callbacks.userData, stream->key.data, stream->key.length );
+  stream->hasKey = false;
+}
+
+static void JSON_EndStreamElement( JSONStream stream )
+{
+  if( stream->hasValue )
+  {
+    if( stream->valueType == JSON_TYPE_NUMBER && JSON_ReadNumber( stream->value.data, stream->value.length, NULL, NULL ) == JSON_READ_INVALID )
+    {
+      stream->error = JSON_ERROR_INVALID_NUMBER;
+      return;
+    }
+    JSON_EmitStreamKey( stream );
+    if( stream->callbacks.scalar != NULL ) 
+      stream->callbacks.scalar( stream->callbacks.userData, stream->valueType, stream->value.data, stream->value.length );
+    if( stream->depth == 0 ) stream->hasDocument = true;
+  }
+  stream->hasValue = stream->hasKey = stream->hasContainer = false;
+}
+
+static void JSON_EndStreamToken( JSONStream stream )
+{
+  const char* literal;
+  size_t length = stream->value.length;
+  stream->valueType = JSON_ReadBareToken( stream->value.data, &length, &literal );
+  stream->value.length = length;
+  stream->hasValue = true;
+  stream->state = JSON_STREAM_VALUE;
+}
+
+static void JSON_ResetStream( JSONStream stream )
+{
+  stream->depth = 0;
+  stream->state = JSON_STREAM_VALUE;
+  stream->error = JSON_OK;
+  stream->isEscaping = stream->hasValue = stream->hasKey = stream->hasContainer = stream->hasDocument = false;
+  stream->value.data = stream->key.data = NULL;
+  stream->value.length = stream->key.length = 0;
+}
+
+JSONStream JSON_CreateStream( const JSONStreamCallbacks* callbacks )
+{
+  JSONStream newStream = (JSONStream) JSON_AllocateHeap( sizeof(JSONStreamData) );
+  if( newStream == NULL ) return NULL;
+  memset( newStream, 0, sizeof(JSONStreamData) );
+  if( callbacks != NULL ) newStream->callbacks = *callbacks;
+  newStream->scanner = JSON_GetScanner();
+  JSON_ResetStream( newStream );
+  return newStream;
+}
+
+int JSON_FeedStream( JSONStream stream, const char* data, size_t length )
+{
+  if( stream == NULL ) return JSON_ERROR_UNEXPECTED;
+  const char* end = data + length;
+  while( data < end && stream->state != JSON_STREAM_DONE && stream->error == JSON_OK ) 
+  {
+    if( stream->state == JSON_STREAM_STRING || stream->state == JSON_STREAM_TOKEN ) 
+    {
+      const char* start = data;
+      if( stream->isEscaping ) data++;                      // Escaped character from the previous chunk
+      stream->isEscaping = false;
+      if( stream->state == JSON_STREAM_STRING ) data = stream->scanner->findStringEnd( data, end, stream->quote );
+      else data = stream->scanner->findTokenEnd( data, end );
+      if( !JSON_ExtendStreamToken( &(stream->value), start, data ) ) 
+      {
+        stream->error = JSON_ERROR_NO_SPACE;
+        break;
+      }
+      if( data >= end )                                     // Token continues in the next chunk
+      {
+        size_t escapesCount = 0;
+        while( escapesCount < stream->value.length && stream->value.data[ stream->value.length - escapesCount - 1 ] == '\\' ) 
+          escapesCount++;
+        stream->isEscaping = ( escapesCount % 2 == 1 );
+        break;
+      }
+      if( stream->state == JSON_STREAM_STRING ) 
+      {
+        stream->valueType = JSON_TYPE_STRING;
+        stream->hasValue = true;
+        stream->state = JSON_STREAM_VALUE;
+        data++;                                             // Skip closing quote
+      }
+      else JSON_EndStreamToken( stream );                   // Terminator is handled as the next token
+      continue;
+    }
+    data = JSON_SkipSpaces( stream->scanner, data, end );
+    if( data >= end ) break;
+    char c = *data;
+    if( c == ',' || c == ']' || c == '}' ) 
+    {
+      JSON_EndStreamElement( stream );
+      if( stream->depth == 0 )                              // Separators/delimiters end the top level value
+      {
+        stream->state = JSON_STREAM_DONE;
+        break;
+      }
+      if( c != ',' ) 
+      {
+        bool isArray = ( stream->containersStack[ stream->depth - 1 ] == '[' );
+        if( isArray != ( c == ']' ) ) 
+        {
+          stream->error = JSON_ERROR_UNEXPECTED;
+          break;
+        }
+        stream->depth--;
+        if( isArray && stream->callbacks.endArray != NULL ) stream->callbacks.endArray( stream->callbacks.userData );
+        else if( !isArray && stream->callbacks.endObject != NULL ) stream->callbacks.endObject( stream->callbacks.userData );
+        stream->hasContainer = true;
+      }
+    }
+    else if( stream->hasContainer )                         // Nothing else may follow a closed container
+    {
+      stream->error = JSON_ERROR_UNEXPECTED;
+      break;
+    }
+    else if( c == '[' || c == '{' ) 
+    {
+      stream->hasValue = false;                             // Container replaces previous scalar, if any
+      JSON_EmitStreamKey( stream );
+      if( stream->depth == 0 ) stream->hasDocument = true;
+      if( stream->depth >= stream->stackSize ) 
+      {
+        size_t stackSize = ( stream->stackSize > 0 ) ? 2 * stream->stackSize : 32;
+        char* containersStack = (char*) JSON_ResizeHeap( stream->containersStack, stream->stackSize, stackSize );
+        if( containersStack == NULL ) 
+        {
+          stream->error = JSON_ERROR_NO_SPACE;
+          break;
+        }
+        stream->containersStack = containersStack;
+        stream->stackSize = stackSize;
+      }
+      stream->containersStack[ stream->depth++ ] = c;
+      if( c == '[' && stream->callbacks.startArray != NULL ) stream->callbacks.startArray( stream->callbacks.userData );
+      else if( c == '{' && stream->callbacks.startObject != NULL ) stream->callbacks.startObject( stream->callbacks.userData );
+    }
+    else if( c == ':' ) 
+    {
+      if( !stream->hasValue ) stream->error = JSON_ERROR_NO_KEY;
+      else if( stream->hasKey ) stream->error = JSON_ERROR_UNEXPECTED;
+      else
+      {
+        JSONStreamToken key = stream->key;                  // Swap tokens to avoid copying
+        stream->key = stream->value;
+        stream->value = key;
+        stream->hasKey = true;
+        stream->hasValue = false;
+      }
+    }
+    else 
+    {
+      stream->state = JSON_STREAM_TOKEN;
+      if( c == '\'' || c == '"' ) 
+      {
+        stream->state = JSON_STREAM_STRING;
+        stream->quote = c;
+        data++;
+      }
+      stream->value.data = data;
+      stream->value.length = 0;
+      continue;
+    }
+    data++;
+  }
+  // Pending tokens referencing this chunk are copied before it goes away
+  if( stream->value.data != stream->value.buffer && !JSON_AppendStreamToken( &(stream->value), NULL, 0 ) ) stream->error = JSON_ERROR_NO_SPACE;
+  if( stream->key.data != stream->key.buffer && !JSON_AppendStreamToken( &(stream->key), NULL, 0 ) ) stream->error = JSON_ERROR_NO_SPACE;
+  return stream->error;
+}
+
+int JSON_FinishStream( JSONStream stream )
+{
+  if( stream == NULL ) return JSON_ERROR_UNEXPECTED;
+  if( stream->error == JSON_OK ) 
+  {
+    if( stream->state == JSON_STREAM_STRING ) stream->error = JSON_ERROR_UNEXPECTED;     // Missing closing quote
+    else if( stream->state == JSON_STREAM_TOKEN ) JSON_EndStreamToken( stream );
+  }
+  if( stream->error == JSON_OK && stream->state == JSON_STREAM_VALUE ) 
+  {
+    if( stream->depth > 0 ) stream->error = JSON_ERROR_UNEXPECTED;                  // Missing closing delimiter
+    else JSON_EndStreamElement( stream );
+  }
+  if( stream->error == JSON_OK && !stream->hasDocument ) stream->error = JSON_ERROR_NO_VALUE;
+  int error = stream->error;
+  JSON_ResetStream( stream );
+  return error;
+}
+
+void JSON_DestroyStream( JSONStream stream )
+{
+  if( stream == NULL ) return;
+  JSON_FreeHeap( stream->containersStack, stream->stackSize );
+  JSON_FreeHeap( stream->value.buffer, stream->value.bufferSize );
+  JSON_FreeHeap( stream->key.buffer, stream->key.bufferSize );
+  JSON_FreeHeap( stream, sizeof(JSONStreamData) );
+}
+
+// Tape entries keep node type (or key/end tags) in the upper bits and position data in the lower ones
+#define JSON_TAPE_KEY             6
+#define JSON_TAPE_END             7
+#define JSON_TAPE_TAG_SHIFT       56
+#define JSON_TAPE_PAYLOAD_MASK    ( ( 1ULL << JSON_TAPE_TAG_SHIFT ) - 1 )
+#define JSON_TAPE_COUNT_SHIFT     32      // Container start entries hold children count (saturated) and index of their end entry
+#define JSON_TAPE_COUNT_MAX       0xFFFFFFULL
+#define JSON_TAPE_INDEX_MASK      0xFFFFFFFFULL
+
+#define JSON_TAPE_TAG( entry ) ( (int) ( (entry) >> JSON_TAPE_TAG_SHIFT ) )
+#define JSON_TAPE_PAYLOAD( entry ) ( (entry) & JSON_TAPE_PAYLOAD_MASK )
+
+struct _JSONTapeData
+{
+  unsigned long long* entries;
+  size_t entriesCount, entriesSize;
+  char* strings;                          // Length prefixed and null terminated string values and keys
+  size_t stringsLength, stringsSize;
+};
+
+typedef struct _JSONTapeFrame
+{
+  size_t startIndex;                      // Entry of container start, completed when it is closed
+  unsigned long long childrenCount;
+}
+JSONTapeFrame;
+
+typedef struct _JSONTapeCursor
+{
+  JSONNode container;
+  size_t child;                           // Tape item of the next child to be materialized
+}
+JSONTapeCursor;
+
+// Output of the shared parser grammar writing tape entries
+typedef struct _JSONTapeParser
+{
+  JSONTape tape;
+  JSONTapeFrame* containersStack;         // Containers still open, innermost last
+  size_t depth, containersStackSize;
+}
+JSONTapeParser;
+
+static bool JSON_PushTapeEntry( JSONTape tape, int tag, unsigned long long payload )
+{
+  if( tape->entriesCount >= tape->entriesSize )
+  {
+    size_t entriesSize = ( tape->entriesSize > 0 ) ? 2 * tape->entriesSize : 256;
+    unsigned long long* entries = (unsigned long long*) JSON_ResizeHeap( tape->entries, tape->entriesSize * sizeof(unsigned long long), 
+                                                                         entriesSize * sizeof(unsigned long long) );
+    if( entries == NULL ) return false;
+    tape->entries = entries;
+    tape->entriesSize = entriesSize;
+  }
+  tape->entries[ tape->entriesCount++ ] = ( (unsigned long long) tag << JSON_TAPE_TAG_SHIFT ) | payload;
+  return true;
+}
+
+static bool JSON_PushTapeString( JSONTape tape, int tag, const char* string, size_t length )
+{
+  size_t neededSize = tape->stringsLength + sizeof(size_t) + length + 1;
+  if( neededSize > tape->stringsSize )
+  {
+    size_t stringsSize = ( 2 * tape->stringsSize > neededSize ) ? 2 * tape->stringsSize : 2 * neededSize;
+    char* strings = (char*) JSON_ResizeHeap( tape->strings, tape->stringsSize, stringsSize );
+    if( strings == NULL ) return false;
+    tape->strings = strings;
+    tape->stringsSize = stringsSize;
+  }
+  if( !JSON_PushTapeEntry( tape, tag, tape->stringsLength ) ) return false;
+  char* stringData = tape->strings + tape->stringsLength;
+  memcpy( stringData, &length, sizeof(size_t) );
+  memcpy( stringData + sizeof(size_t), string, length );
+  stringData[ sizeof(size_t) + length ] = '\0';
+  tape->stringsLength = neededSize;
+  return true;
+}
+
+static const char* JSON_GetTapeString( JSONTape tape, size_t item, size_t* ref_length )
+{
+  const char* stringData = tape->strings + JSON_TAPE_PAYLOAD( tape->entries[ item ] );
+  if( ref_length != NULL ) memcpy( ref_length, stringData, sizeof(size_t) );
+  return stringData + sizeof(size_t);
+}
+
+// Start tape item with its key, if any. Root item has a fixed position, after its key or a placeholder entry
+static int JSON_StartTapeItem( JSONTapeParser* parser, const JSONElement* element )
+{
+  if( parser->depth > 0 ) parser->containersStack[ parser->depth - 1 ].childrenCount++;
+  if( element->key != NULL ) 
+  {
+    if( !JSON_PushTapeString( parser->tape, JSON_TAPE_KEY, element->key, element->keyLength ) ) return JSON_ERROR_NO_SPACE;
+  }
+  else if( parser->depth == 0 && !JSON_PushTapeEntry( parser->tape, JSON_TAPE_END, 0 ) ) return JSON_ERROR_NO_SPACE;
+  return JSON_OK;
+}
+
+static int JSON_AddTapeValue( void* output, const JSONElement* element )
+{
+  JSONTapeParser* parser = (JSONTapeParser*) output;
+  int error = JSON_StartTapeItem( parser, element );
+  if( error != JSON_OK ) return error;
+  if( element->literal != NULL ) 
+  {
+    if( !JSON_PushTapeEntry( parser->tape, element->type, ( element->literal == TRUE_STR ) ) ) return JSON_ERROR_NO_SPACE;
+  }
+  else if( !JSON_PushTapeString( parser->tape, element->type, element->value, element->length ) ) return JSON_ERROR_NO_SPACE;
+  return JSON_OK;
+}
+
+static int JSON_OpenTapeContainer( void* output, const JSONElement* element )
+{
+  JSONTapeParser* parser = (JSONTapeParser*) output;
+  int error = JSON_StartTapeItem( parser, element );
+  if( error != JSON_OK ) return error;
+  if( parser->depth >= parser->containersStackSize )
+  {
+    size_t stackSize = ( parser->containersStackSize > 0 ) ? 2 * parser->containersStackSize : 32;
+    JSONTapeFrame* containersStack = (JSONTapeFrame*) JSON_ResizeHeap( parser->containersStack, parser->containersStackSize * sizeof(JSONTapeFrame), 
+                                                                       stackSize * sizeof(JSONTapeFrame) );
+    if( containersStack == NULL ) return JSON_ERROR_NO_SPACE;
+    parser->containersStack = containersStack;
+    parser->containersStackSize = stackSize;
+  }
+  JSONTapeFrame* frame = &(parser->containersStack[ parser->depth ]);
+  frame->startIndex = parser->tape->entriesCount;
+  frame->childrenCount = 0;
+  if( !JSON_PushTapeEntry( parser->tape, element->type, 0 ) ) return JSON_ERROR_NO_SPACE;
+  parser->depth++;
+  return JSON_OK;
+}
+
+static int JSON_CloseTapeContainer( void* output )
+{
+  JSONTapeParser* parser = (JSONTapeParser*) output;
+  JSONTape tape = parser->tape;
+  JSONTapeFrame* frame = &(parser->containersStack[ --parser->depth ]);
+  size_t endIndex = tape->entriesCount;
+  if( endIndex > JSON_TAPE_INDEX_MASK || !JSON_PushTapeEntry( tape, JSON_TAPE_END, frame->startIndex ) ) return JSON_ERROR_NO_SPACE;
+  unsigned long long childrenCount = ( frame->childrenCount > JSON_TAPE_COUNT_MAX ) ? JSON_TAPE_COUNT_MAX : frame->childrenCount;
+  tape->entries[ frame->startIndex ] |= ( childrenCount << JSON_TAPE_COUNT_SHIFT ) | endIndex;
+  return JSON_OK;
+}
+
+static const JSONParserSink JSON_TAPE_SINK = { JSON_AddTapeValue, JSON_OpenTapeContainer, JSON_CloseTapeContainer };
+
+JSONTape JSON_ParseTape( const char* jsonData, size_t length )
+{
+  if( jsonData == NULL ) return NULL;
+  JSONTape newTape = (JSONTape) JSON_AllocateHeap( sizeof(JSONTapeData) );
+  if( newTape == NULL ) return NULL;
+  memset( newTape, 0, sizeof(JSONTapeData) );
+  unsigned long long startTime = JSON_GetTime();
+  // Same grammar as the tree parser, with tape entries as output
+  JSONParser parser = { .end = jsonData + length, .scanner = JSON_GetScanner() };
+  JSONTapeParser tapeParser = { .tape = newTape };
+  int error = JSON_ParseElements( &parser, &JSON_TAPE_SINK, &tapeParser, &jsonData );
+  if( error == JSON_OK && newTape->entriesCount == 0 ) error = JSON_ERROR_NO_VALUE;
+  JSON_ReleaseParser( &parser );
+  JSON_FreeHeap( tapeParser.containersStack, tapeParser.containersStackSize * sizeof(JSONTapeFrame) );
+  JSON_ADD_COUNTER( counters.parseTime, JSON_GetTime() - startTime );
+  if( error != JSON_OK )
+  {
+    JSON_DestroyTape( newTape );
+    return NULL;
+  }
+  return newTape;
+}
+
+void JSON_DestroyTape( JSONTape tape )
+{
+  if( tape == NULL ) return;
+  JSON_FreeHeap( tape->entries, tape->entriesSize * sizeof(unsigned long long) );
+  JSON_FreeHeap( tape->strings, tape->stringsSize );
+  JSON_FreeHeap( tape, sizeof(JSONTapeData) );
+}
+
+static inline bool JSON_IsTapeItem( JSONTape tape, size_t item )
+{
+  return ( tape != NULL && item >= JSON_TAPE_ROOT && item < tape->entriesCount );
+}
+
+enum JSONNodeType JSON_GetTapeType( JSONTape tape, size_t item )
+{
+  if( !JSON_IsTapeItem( tape, item ) ) return JSON_TYPE_NULL;
+  return (enum JSONNodeType) JSON_TAPE_TAG( tape->entries[ item ] );
+}
+
+const char* JSON_GetTapeValue( JSONTape tape, size_t item )
+{
+  if( !JSON_IsTapeItem( tape, item ) ) return NULL;
+  int tag = JSON_TAPE_TAG( tape->entries[ item ] );
+  if( tag == JSON_TYPE_NULL ) return NULL_STR;
+  if( tag == JSON_TYPE_BOOLEAN ) return JSON_TAPE_PAYLOAD( tape->entries[ item ] ) ? TRUE_STR : FALSE_STR;
+  if( tag == JSON_TYPE_NUMBER || tag == JSON_TYPE_STRING ) return JSON_GetTapeString( tape, item, NULL );
+  return NULL;
+}
+
+size_t JSON_GetTapeLength( JSONTape tape, size_t item )
+{
+  if( !JSON_IsTapeItem( tape, item ) ) return 0;
+  int tag = JSON_TAPE_TAG( tape->entries[ item ] );
+  if( tag != JSON_TYPE_NUMBER && tag != JSON_TYPE_STRING ) 
+    return ( tag == JSON_TYPE_NULL || tag == JSON_TYPE_BOOLEAN ) ? strlen( JSON_GetTapeValue( tape, item ) ) : 0;
+  size_t length;
+  JSON_GetTapeString( tape, item, &length );
+  return length;
+}
+
+const char* JSON_GetTapeKey( JSONTape tape, size_t item )
+{
+  // Keys are stored right before the values of object members
+  if( !JSON_IsTapeItem( tape, item ) || JSON_TAPE_TAG( tape->entries[ item - 1 ] ) != JSON_TAPE_KEY ) return NULL;
+  return JSON_GetTapeString( tape, item - 1, NULL );
+}
+
+size_t JSON_GetTapeNext( JSONTape tape, size_t item )
+{
+  if( !JSON_IsTapeItem( tape, item ) ) return JSON_TAPE_NONE;
+  unsigned long long entry = tape->entries[ item ];
+  int tag = JSON_TAPE_TAG( entry );
+  // Jump over whole containers
+  size_t next = ( tag == JSON_TYPE_BRACKET || tag == JSON_TYPE_BRACE ) ? ( entry & JSON_TAPE_INDEX_MASK ) + 1 : item + 1;
+  if( next < tape->entriesCount && JSON_TAPE_TAG( tape->entries[ next ] ) == JSON_TAPE_KEY ) next++;
+  if( next >= tape->entriesCount || JSON_TAPE_TAG( tape->entries[ next ] ) == JSON_TAPE_END ) return JSON_TAPE_NONE;
+  return next;
+}
+
+static size_t JSON_GetTapeFirstChild( JSONTape tape, size_t item )
+{
+  size_t child = item + 1;
+  if( JSON_TAPE_TAG( tape->entries[ child ] ) == JSON_TAPE_KEY ) child++;
+  return ( JSON_TAPE_TAG( tape->entries[ child ] ) == JSON_TAPE_END ) ? JSON_TAPE_NONE : child;
+}
+
+unsigned long JSON_GetTapeChildrenCount( JSONTape tape, size_t item )
+{
+  enum JSONNodeType type = JSON_GetTapeType( tape, item );
+  if( type != JSON_TYPE_BRACKET && type != JSON_TYPE_BRACE ) return 0;
+  unsigned long childrenCount = (unsigned long) ( JSON_TAPE_PAYLOAD( tape->entries[ item ] ) >> JSON_TAPE_COUNT_SHIFT );
+  if( childrenCount < JSON_TAPE_COUNT_MAX ) return childrenCount;
+  // Count stored in the entry is saturated. Count children one by one
+  childrenCount = 0;
+  for( size_t child = JSON_GetTapeFirstChild( tape, item ); child != JSON_TAPE_NONE; child = JSON_GetTapeNext( tape, child ) )
+    childrenCount++;
+  return childrenCount;
+}
+
+size_t JSON_FindTapeKey( JSONTape tape, size_t item, const char* key )
+{
+  if( JSON_GetTapeType( tape, item ) != JSON_TYPE_BRACE ) return JSON_TAPE_NONE;
+  size_t keyLength = strlen( key );
+  for( size_t child = JSON_GetTapeFirstChild( tape, item ); child != JSON_TAPE_NONE; child = JSON_GetTapeNext( tape, child ) )
+  {
+    if( JSON_TAPE_TAG( tape->entries[ child - 1 ] ) != JSON_TAPE_KEY ) continue;      // Object members may lack keys, as in trees
+    size_t childKeyLength;
+    const char* childKey = JSON_GetTapeString( tape, child - 1, &childKeyLength );
+    if( childKeyLength == keyLength && memcmp( childKey, key, keyLength ) == 0 ) return child;
+  }
+  return JSON_TAPE_NONE;
+}
+
+size_t JSON_FindTapeIndex( JSONTape tape, size_t item, long index )
+{
+  enum JSONNodeType type = JSON_GetTapeType( tape, item );
+  if( ( type != JSON_TYPE_BRACKET && type != JSON_TYPE_BRACE ) || index < 0 ) return JSON_TAPE_NONE;
+  size_t child = JSON_GetTapeFirstChild( tape, item );
+  while( child != JSON_TAPE_NONE && index-- > 0 ) child = JSON_GetTapeNext( tape, child );
+  return child;
+}
+
+// Create node for tape item, with its key and value. Containers get a children list allocated for the whole count, to be filled afterwards
+static JSONNode JSON_CreateTapeNode( JSONTape tape, size_t item )
+{
+  JSONNode newNode = JSON_CreateNode( NULL, JSON_GetTapeType( tape, item ) );
+  if( newNode == NULL ) return NULL;
+  if( JSON_TAPE_TAG( tape->entries[ item - 1 ] ) == JSON_TAPE_KEY ) 
+  {
+    size_t keyLength;
+    const char* key = JSON_GetTapeString( tape, item - 1, &keyLength );
+    newNode->key = JSON_CreateKey( NULL, key, keyLength, JSON_HashKey( key, keyLength ) );
+    if( newNode->key == NULL ) 
+    {
+      JSON_Destroy( newNode );
+      return NULL;
+    }
+    newNode->keyLength = (unsigned int) keyLength;
+    newNode->flags |= JSON_KEY_SHARED;
+  }
+  if( JSON_IS_INTERNAL( newNode ) ) 
+  {
+    size_t capacity = JSON_GetTapeChildrenCount( tape, item );
+    if( capacity > 0 ) 
+    {
+      newNode->childrenList = (JSONNode*) JSON_AllocateHeap( capacity * sizeof(JSONNode) );
+      if( newNode->childrenList == NULL ) 
+      {
+        JSON_Destroy( newNode );
+        return NULL;
+      }
+    }
+    newNode->capacity = capacity;
+  }
+  else if( newNode->type == JSON_TYPE_NULL || newNode->type == JSON_TYPE_BOOLEAN ) 
+  {
+    newNode->value = (char*) JSON_GetTapeValue( tape, item );
+    newNode->size = strlen( newNode->value );
+    newNode->flags |= JSON_DATA_EXTERNAL;
+  }
+  else
+  {
+    size_t length;
+    const char* value = JSON_GetTapeString( tape, item, &length );
+    newNode->value = JSON_CopyString( NULL, value, length );
+    if( newNode->value == NULL ) 
+    {
+      JSON_Destroy( newNode );
+      return NULL;
+    }
+    newNode->size = length;
+    if( newNode->type == JSON_TYPE_NUMBER ) JSON_CacheNumber( newNode, false );
+  }
+  return newNode;
+}
+
+// Build tree in tape order with an explicit stack instead of recursion, so that depth is limited only by memory
+JSONNode JSON_MaterializeTape( JSONTape tape, size_t item )
+{
+  if( !JSON_IsTapeItem( tape, item ) ) return NULL;
+  JSONNode root = JSON_CreateTapeNode( tape, item );
+  if( root == NULL || !JSON_IS_INTERNAL( root ) ) return root;
+  JSONTapeCursor localStack[ JSON_WRITER_STACK_SIZE ];
+  JSONTapeCursor* containersStack = localStack;                   // Containers with children left to create, innermost last
+  size_t stackSize = JSON_WRITER_STACK_SIZE, level = 0;
+  containersStack[ level++ ] = (JSONTapeCursor) { root, JSON_GetTapeFirstChild( tape, item ) };
+  bool isValid = true;
+  while( level > 0 ) 
+  {
+    JSONTapeCursor* cursor = &(containersStack[ level - 1 ]);
+    if( cursor->child == JSON_TAPE_NONE ) 
+    {
+      JSON_PrepareKeyIndex( NULL, cursor->container );
+      level--;
+      continue;
+    }
+    size_t child = cursor->child;
+    JSONNode container = cursor->container;
+    cursor->child = JSON_GetTapeNext( tape, child );
+    // Nodes are linked to their parents as soon as created, so that the whole partial tree is released on errors
+    JSONNode node = JSON_CreateTapeNode( tape, child );
+    if( node == NULL ) 
+    {
+      isValid = false;
+      break;
+    }
+    node->parent = container;
+    container->childrenList[ container->size++ ] = node;
+    if( JSON_IS_INTERNAL( node ) && node->capacity > 0 ) 
+    {
+      if( level >= stackSize ) 
+      {
+        JSONTapeCursor* newStack = (JSONTapeCursor*) JSON_AllocateHeap( 2 * stackSize * sizeof(JSONTapeCursor) );
+        if( newStack == NULL ) 
+        {
+          isValid = false;
+          break;
+        }
+        memcpy( newStack, containersStack, level * sizeof(JSONTapeCursor) );
+        if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONTapeCursor) );
+        containersStack = newStack;
+        stackSize *= 2;
+      }
+      containersStack[ level++ ] = (JSONTapeCursor) { node, JSON_GetTapeFirstChild( tape, child ) };
+    }
+  }
+  if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONTapeCursor) );
+  if( !isValid ) 
+  {
+    JSON_Destroy( root );
+    return NULL;
+  }
+  return root;
+}
+
+JSONNode JSON_Create( enum JSONNodeType type, const char* key )
+{
+  JSONNode newNode = JSON_CreateNode( NULL, type );
+  if( newNode == NULL ) return NULL;
+  if( key ) 
+  {
+    size_t keyLength = strlen( key );
+    newNode->key = JSON_CreateKey( NULL, key, keyLength, JSON_HashKey( key, keyLength ) );
+    if( newNode->key == NULL ) 
+    {
+      JSON_Destroy( newNode );
+      return NULL;
+    }
+    newNode->keyLength = (unsigned int) keyLength;
+    newNode->flags |= JSON_KEY_SHARED;
+  }
+  return newNode;
+}
+
+// Set key of new child at given position, sharing the one at same position of the previous object 
+// when both are records of an array (rows built with the same shape). Other added keys are copied, 
+// as heap trees have no table of their keys once parsed
+static bool JSON_SetChildKey( JSONNode root, JSONNode child, size_t position, const char* key, size_t keyLength )
+{
+  JSONNode parent = root->parent;
+  child->key = NULL;
+  if( parent != NULL && parent->type == JSON_TYPE_BRACKET && parent->size >= 2 && parent->childrenList[ parent->size - 1 ] == root ) 
+  {
+    JSONNode record = parent->childrenList[ parent->size - 2 ];
+    if( record->type == JSON_TYPE_BRACE && !( record->flags & JSON_CHILDREN_PENDING ) && record->size > position ) 
+    {
+      JSONNode sibling = record->childrenList[ position ];
+      if( ( sibling->flags & ( JSON_KEY_SHARED | JSON_KEY_EXTERNAL ) ) == JSON_KEY_SHARED && JSON_IsKey( sibling, key, keyLength ) ) 
+        child->key = JSON_RetainKey( sibling->key );
+    }
+  }
+  if( child->key == NULL ) child->key = JSON_CreateKey( NULL, key, keyLength, JSON_HashKey( key, keyLength ) );
+  if( child->key == NULL ) return false;
+  child->keyLength = (unsigned int) keyLength;
+  child->flags |= JSON_KEY_SHARED;
+  return true;
+}
+
+// Reallocate children list with given number of slots (not less than current children count)
+static bool JSON_ResizeChildren( JSONNode root, size_t capacity )
+{
+  if( capacity < root->size ) capacity = root->size;
+  if( capacity > UINT_MAX ) return false;
+  JSONNode* childrenList = NULL;
+  if( root->flags & JSON_DATA_EXTERNAL )          // Move arena owned children list to the heap before changing it
+  {
+    if( capacity > 0 ) 
+    {
+      childrenList = (JSONNode*) JSON_AllocateHeap( capacity * sizeof(JSONNode) );
+      if( childrenList == NULL ) return false;
+      if( root->size > 0 ) memcpy( childrenList, root->childrenList, (size_t) root->size * sizeof(JSONNode) );
+    }
+    root->flags &= ~JSON_DATA_EXTERNAL;
+  }
+  else if( capacity > 0 ) 
+  {
+    childrenList = (JSONNode*) JSON_ResizeHeap( root->childrenList, root->capacity * sizeof(JSONNode), capacity * sizeof(JSONNode) );
+    if( childrenList == NULL ) return false;
+  }
+  else JSON_FreeHeap( root->childrenList, root->capacity * sizeof(JSONNode) );
+  root->childrenList = childrenList;
+  root->capacity = (unsigned int) capacity;
+  return true;
+}
+
+JSONNode JSON_AddNode( JSONNode root, enum JSONNodeType type, const char *key )
+{
+  if( ( root->flags & JSON_FROZEN ) || ( !JSON_LoadChildren( root ) && ( root->flags & JSON_CHILDREN_PENDING ) ) ) return NULL;
+  if( root->size >= root->capacity || ( root->flags & JSON_DATA_EXTERNAL ) ) 
+  {
+    // Geometric growth, for amortized constant time appends
+    if( !JSON_ResizeChildren( root, ( root->size > 0 ) ? 2 * root->size : 4 ) ) return NULL;
+  }
+  JSONNode child = JSON_Create( type, NULL );
+  if( child == NULL ) return NULL;
+  if( key != NULL && !JSON_SetChildKey( root, child, root->size, key, strlen( key ) ) ) 
+  {
+    JSON_Destroy( child );
+    return NULL;
+  }
+  child->parent = root;
+  root->childrenList[ root->size++ ] = child;
+  JSON_InvalidateOutput( root );
+  if( child->type == JSON_TYPE_NULL ) JSON_Set( child, NULL );
+  if( root->keyIndex != NULL && key != NULL ) 
+  {
+    if( 2 * root->size > root->keyIndex->slotsCount ) JSON_BuildKeyIndex( NULL, root, 2 * root->size );
+    else JSON_InsertKeySlot( root->keyIndex, JSON_GetKeyHash( child ), root->size - 1 );
+  }
+  else JSON_PrepareKeyIndex( NULL, root );
+  return child;
+}
+
+JSONNode JSON_AddKey( JSONNode root, enum JSONNodeType type, const char* key )
+{
+  if( root->type != JSON_TYPE_BRACE ) return NULL;
+  JSONNode child = JSON_FindChild( root, key, strlen( key ) );
+  if( child != NULL ) return child; // (child->type == type) ? child : NULL;
+  return JSON_AddNode( root, type, key );
+}
+
+JSONNode JSON_AddIndex( JSONNode root, enum JSONNodeType type )
+{
+  if( root->type != JSON_TYPE_BRACKET ) return NULL;
+  return JSON_AddNode( root, type, NULL );
+}
+
+int JSON_Reserve( JSONNode root, size_t capacity )
+{
+  if( root == NULL || !JSON_IS_INTERNAL( root ) || ( root->flags & JSON_FROZEN ) ) return JSON_ERROR_UNEXPECTED;
+  if( !JSON_LoadChildren( root ) && ( root->flags & JSON_CHILDREN_PENDING ) ) return JSON_ERROR_NO_SPACE;
+  if( capacity <= root->size || ( capacity <= root->capacity && !( root->flags & JSON_DATA_EXTERNAL ) ) ) return JSON_OK;
+  return JSON_ResizeChildren( root, capacity ) ? JSON_OK : JSON_ERROR_NO_SPACE;
+}
+
+void JSON_ShrinkToFit( JSONNode root )
+{
+  if( root == NULL || !JSON_IS_INTERNAL( root ) || ( root->flags & ( JSON_DATA_EXTERNAL | JSON_FROZEN ) ) ) return;
+  if( root->capacity > root->size ) JSON_ResizeChildren( root, root->size );
+}
+
+enum JSONNodeType JSON_GetType( JSONNode root )
+{
+  return (enum JSONNodeType) root->type;
+}
+
+const char* JSON_Get( JSONNode root )
+{
+  if( JSON_IS_INTERNAL( root ) ) return NULL;
+  if( root->flags & JSON_TEXT_STALE )         // Generate text of number changed in binary form
+  {
+    char numberBuffer[ JSON_NUMBER_MAX_LENGTH ];
+    size_t length = JSON_FormatCachedNumber( root, numberBuffer );
+    char* value = JSON_CopyString( NULL, numberBuffer, length );
+    if( value == NULL ) return NULL;          // Kept stale, to be generated again on next access
+    root->value = value;
+    root->size = length;
+    root->flags &= ~( JSON_TEXT_STALE | JSON_DATA_EXTERNAL );
+  }
+  if( root->flags & JSON_VALUE_SLICE )        // Terminate referenced value on first access
+  {
+    if( root->flags & JSON_SOURCE_MUTABLE ) 
+      root->value[ root->size ] = '\0';       // Delimiter following the value is not needed after parsing
+    else
+    {
+      char* value = JSON_CopyString( NULL, root->value, root->size );
+      if( value == NULL ) return NULL;        // Kept as slice, to be copied again on next access
+      root->value = value;
+      root->flags &= ~JSON_DATA_EXTERNAL;
+    }
+    root->flags &= ~( JSON_VALUE_SLICE | JSON_SOURCE_MUTABLE );
+  }
+  
+  return (const char*) root->value;
+}
+
+size_t JSON_GetLength( JSONNode root )
+{
+  if( root->flags & JSON_TEXT_STALE ) JSON_Get( root );
+  if( JSON_IS_INTERNAL( root ) || root->value == NULL ) return 0;
+  
+  return (size_t) root->size;
+}
+
+unsigned long JSON_GetChildrenCount( JSONNode root )
+{
+  if( !JSON_IS_INTERNAL( root ) || !JSON_LoadChildren( root ) ) return 0;
+  
+  return root->size;
+}
+
+static void JSON_ReleaseText( JSONNode root )
+{
+  if( root->value && !( root->flags & JSON_DATA_EXTERNAL ) ) JSON_FreeHeap( root->value, (size_t) root->size + 1 );
+  root->value = NULL;
+  root->size = 0;
+  root->flags &= ~( JSON_DATA_EXTERNAL | JSON_VALUE_SLICE | JSON_SOURCE_MUTABLE | JSON_TEXT_STALE | JSON_NUMBER_CACHED | JSON_NUMBER_INTEGER );
+}
+
+void JSON_Set( JSONNode root, const char* value )
+{
+  if( JSON_IS_INTERNAL( root ) || ( root->flags & JSON_FROZEN ) ) return;
+  JSON_ReleaseText( root );
+  JSON_InvalidateOutput( root->parent );
+  if( root->type == JSON_TYPE_BOOLEAN || root->type == JSON_TYPE_NULL ) 
+  {
+    // Literals reference constant strings, without allocation
+    if( root->type == JSON_TYPE_BOOLEAN ) root->value = (char*) ( (value) ? TRUE_STR : FALSE_STR );
+    else root->value = (char*) NULL_STR;
+    root->flags |= JSON_DATA_EXTERNAL;
+    root->size = strlen( root->value );
+  }
+  else if( value ) 
+  {
+    size_t length = strlen( value );
+    root->value = JSON_CopyString( NULL, value, length );
+    if( root->value != NULL ) root->size = length;
+  }
+}
+
+double JSON_GetNumber( JSONNode root )
+{
+  if( root->type != JSON_TYPE_NUMBER ) return 0.0;
+  if( root->flags & JSON_NUMBER_CACHED ) return ( root->flags & JSON_NUMBER_INTEGER ) ? (double) root->integer : root->number;
+  if( root->value == NULL ) return 0.0;
+  // Numbers not converted at parse time are converted on each read, as reading must not write to shared trees
+  long long integer;
+  double real;
+  int numberClass = JSON_ConvertNumber( root, true, &integer, &real );
+  return ( numberClass == JSON_READ_INTEGER ) ? (double) integer : real;
+}
+
+long long JSON_GetInteger( JSONNode root )
+{
+  if( root->type != JSON_TYPE_NUMBER ) return 0;
+  long long integer = root->integer;
+  double real = root->number;
+  int numberClass = ( root->flags & JSON_NUMBER_INTEGER ) ? JSON_READ_INTEGER : JSON_READ_REAL;
+  if( !( root->flags & JSON_NUMBER_CACHED ) ) 
+  {
+    if( root->value == NULL ) return 0;
+    numberClass = JSON_ConvertNumber( root, true, &integer, &real );
+  }
+  if( numberClass == JSON_READ_INTEGER ) return integer;
+  if( !( real > (double) LLONG_MIN && real < (double) LLONG_MAX ) ) return ( real > 0 ) ? LLONG_MAX : LLONG_MIN;
+  return (long long) real;
+}
+
+bool JSON_GetBoolean( JSONNode root )
+{
+  return ( root->type == JSON_TYPE_BOOLEAN && root->value == TRUE_STR );
+}
+
+void JSON_SetNumber( JSONNode root, double value )
+{
+  if( root->type != JSON_TYPE_NUMBER || ( root->flags & JSON_FROZEN ) ) return;
+  if( isnan( value ) || isinf( value ) )      // Not representable in JSON: node becomes null, as it would be written
+  {
+    root->type = JSON_TYPE_NULL;
+    JSON_Set( root, NULL );
+    return;
+  }
+  JSON_ReleaseText( root );                   // Text is only generated when read or written
+  JSON_InvalidateOutput( root->parent );
+  root->number = value;
+  root->flags |= JSON_NUMBER_CACHED | JSON_TEXT_STALE;
+}
+
+void JSON_SetInteger( JSONNode root, long long value )
+{
+  if( root->type != JSON_TYPE_NUMBER || ( root->flags & JSON_FROZEN ) ) return;
+  JSON_ReleaseText( root );
+  JSON_InvalidateOutput( root->parent );
+  root->integer = value;
+  root->flags |= JSON_NUMBER_CACHED | JSON_NUMBER_INTEGER | JSON_TEXT_STALE;
+}
+
+void JSON_SetBoolean( JSONNode root, bool value )
+{
+  if( root->type != JSON_TYPE_BOOLEAN ) return;
+  JSON_Set( root, value ? TRUE_STR : NULL );
+}
+
+void JSON_Clear( JSONNode root )
+{
+  if( root == NULL || ( root->flags & JSON_FROZEN ) ) return;
+  JSON_InvalidateOutput( JSON_IS_INTERNAL( root ) ? root : root->parent );
+  if( JSON_IS_INTERNAL( root ) ) 
+  {
+    // Descendants pending release are chained through their key pointers (released beforehand), 
+    // so that trees of any depth are destroyed without recursion or extra memory
+    JSONNode pendingList = NULL;
+    JSONNode node = root;
+    while( node != NULL ) 
+    {
+      if( JSON_IS_INTERNAL( node ) ) 
+      {
+        for( long childIndex = 0; childIndex < (long) node->size; ++childIndex ) 
+        {
+          JSONNode child = node->childrenList[ childIndex ];
+          // Shared subtree is released by its last owner only
+          if( ( child->flags & JSON_FROZEN ) && JSON_ADD_SHARED( child->referencesCount, (unsigned int) -1 ) > 0 ) continue;
+          JSON_ReleaseKey( child );
+          child->key = (char*) pendingList;
+          pendingList = child;
+        }
+        if( node->childrenList && !( node->flags & JSON_DATA_EXTERNAL ) ) JSON_FreeHeap( node->childrenList, node->capacity * sizeof(JSONNode) );
+        if( node != root ) JSON_ReleaseKeyIndex( node );
+      }
+      else JSON_ReleaseText( node );
+      if( node != root && !( node->flags & JSON_NODE_EXTERNAL ) ) JSON_ReleaseNode( node );
+      node = pendingList;
+      if( node != NULL ) pendingList = (JSONNode) node->key;
+    }
+    root->childrenList = NULL;
+    root->capacity = 0;
+    JSON_ReleaseKeyIndex( root );
+  }
+  else JSON_ReleaseText( root );
+  root->flags &= ~( JSON_DATA_EXTERNAL | JSON_INDEX_EXTERNAL | JSON_CHILDREN_PENDING );
+  root->size = 0;
+}
+
+void JSON_Destroy( JSONNode root )
+{
+  if( root == NULL ) return;
+  if( root->flags & JSON_FROZEN ) 
+  {
+    if( JSON_ADD_SHARED( root->referencesCount, (unsigned int) -1 ) > 0 ) return;
+    root->flags &= ~JSON_FROZEN;                      // Last reference: released as a regular tree
+    root->parent = NULL;
+  }
+  JSON_Clear( root );
+  JSON_ReleaseKey( root );
+  if( root->flags & JSON_NODE_EXTERNAL ) return;    // Node memory is released along with its arena
+  JSON_ReleaseNode( root );
+}
+
+JSONNode JSON_FindByKey( const JSONNode root, const char* key )
+{
+  if( !JSON_IS_INTERNAL( root ) ) return NULL;
+  return JSON_FindChild( root, key, strlen( key ) );
+}
+
+JSONNode JSON_FindByIndex( const JSONNode root, long index )
+{
+  if( !JSON_IS_INTERNAL( root ) || !JSON_LoadChildren( root ) ) return NULL;
+  return( 0 <= index && index < (long) root->size ) ? root->childrenList[ index ] : NULL;
+}
+
+JSONNode JSON_FindByPath( const JSONNode root, int pathArgsCount, ... )
+{
+  va_list pathArgsList;
+  va_start( pathArgsList, pathArgsCount );
+  JSONNode child = (JSONNode) root;
+  while( child != NULL && pathArgsCount > 0 ) 
+  {
+    if( child->type == JSON_TYPE_BRACE ) 
+      child = JSON_FindByKey( child, va_arg( pathArgsList, const char* ) );
+    else if( child->type == JSON_TYPE_BRACKET )
+      child = JSON_FindByIndex( child, va_arg( pathArgsList, long ) );
+    else 
+      child = NULL;                             // Path continues past a non container node
+    --pathArgsCount;
+  }
+  va_end( pathArgsList );
+  return child;
+}
+
+typedef struct _JSONPathSegment
+{
+  const char* key;                              // NULL for index segments
+  size_t keyLength;
+  unsigned int keyHash;
+  long index;                                   // Child index, or last position where key was found
+}
+JSONPathSegment;
+
+struct _JSONPathData
+{
+  size_t allocationSize;
+  size_t segmentsCount;
+  JSONPathSegment segments[];                   // Followed by storage for unescaped keys
+};
+
+JSONPath JSON_CompilePath( const char* pathString )
+{
+  if( pathString == NULL ) return NULL;
+  size_t pathLength = strlen( pathString );
+  // Every segment takes at least one character, so this is enough for segments and their keys
+  size_t allocationSize = sizeof(JSONPathData) + ( pathLength + 1 ) * sizeof(JSONPathSegment) + pathLength + 1;
+  JSONPath newPath = (JSONPath) JSON_AllocateHeap( allocationSize );
+  if( newPath == NULL ) return NULL;
+  newPath->allocationSize = allocationSize;
+  char* keysBuffer = (char*) ( newPath->segments + pathLength + 1 );
+  newPath->segmentsCount = 0;
+  const char* pathChar = pathString;
+  while( *pathChar != '\0' ) 
+  {
+    JSONPathSegment* segment = &(newPath->segments[ newPath->segmentsCount ]);
+    segment->key = NULL;
+    segment->index = 0;
+    bool isIndex = ( *pathChar == '[' && pathChar[ 1 ] >= '0' && pathChar[ 1 ] <= '9' );
+    if( isIndex )                                                                   // [<index>]
+    {
+      char* indexEnd;
+      segment->index = strtol( pathChar + 1, &indexEnd, 10 );
+      if( *indexEnd != ']' ) break;
+      pathChar = indexEnd + 1;
+    }
+    else if( *pathChar == '[' && ( pathChar[ 1 ] == '"' || pathChar[ 1 ] == '\'' ) )  // ["<key>"], for keys with any character
+    {
+      char quote = pathChar[ 1 ];
+      const char* keyEnd = strchr( pathChar + 2, quote );
+      if( keyEnd == NULL || keyEnd[ 1 ] != ']' ) break;
+      segment->keyLength = keyEnd - ( pathChar + 2 );
+      memcpy( keysBuffer, pathChar + 2, segment->keyLength );
+      pathChar = keyEnd + 2;
+    }
+    else                                                                            // <key>
+    {
+      segment->keyLength = strcspn( pathChar, ".[" );
+      if( segment->keyLength == 0 ) break;
+      memcpy( keysBuffer, pathChar, segment->keyLength );
+      pathChar += segment->keyLength;
+    }
+    if( !isIndex ) 
+    {
+      segment->key = keysBuffer;
+      segment->keyHash = JSON_HashKey( keysBuffer, segment->keyLength );
+      keysBuffer += segment->keyLength;
+    }
+    newPath->segmentsCount++;
+    if( *pathChar == '.' ) 
+    {
+      if( pathChar[ 1 ] == '\0' || pathChar[ 1 ] == '.' || pathChar[ 1 ] == '[' ) break;   // Separator not followed by a key
+      pathChar++;
+    }
+    else if( *pathChar != '[' && *pathChar != '\0' ) break;                          // Key right after ']', without separator
+  }
+  if( *pathChar != '\0' )                                                           // Malformed path
+  {
+    JSON_DestroyPath( newPath );
+    return NULL;
+  }
+  return newPath;
+}
+
+JSONNode JSON_Resolve( const JSONNode root, JSONPath path )
+{
+  if( root == NULL || path == NULL ) return NULL;
+  JSONNode child = (JSONNode) root;
+  for( size_t segmentIndex = 0; segmentIndex < path->segmentsCount && child != NULL; segmentIndex++ ) 
+  {
+    JSONPathSegment* segment = &(path->segments[ segmentIndex ]);
+    if( !JSON_IS_INTERNAL( child ) || !JSON_LoadChildren( child ) ) return NULL;
+    if( segment->key == NULL ) 
+    {
+      child = JSON_FindByIndex( child, segment->index );
+      continue;
+    }
+    // Check position of the last resolution first, as trees are usually stable between calls
+    long position = segment->index;
+    if( position >= (long) child->size || !JSON_IsHashedKey( child->childrenList[ position ], segment->key, segment->keyLength, segment->keyHash ) ) 
+    {
+      position = JSON_FindChildPosition( child, segment->key, segment->keyLength, segment->keyHash );
+      if( position < 0 ) return NULL;
+      segment->index = position;
+    }
+    child = child->childrenList[ position ];
+  }
+  return child;
+}
+
+void JSON_DestroyPath( JSONPath path )
+{
+  if( path == NULL ) return;
+  JSON_FreeHeap( path, path->allocationSize );
+}
+
+#define JSON_WRITER_CHUNK_SIZE    4096
+
+typedef struct _JSONOutputRange
+{
+  JSONNode container;                         // NULL for empty slots
+  unsigned int offset, length;                // Position (relative to parent) and size of container text in last cached write
+}
+JSONOutputRange;
+
+// Output ranges of containers, kept by cache handles instead of nodes. Open addressing hash table, sized to at most half full
+typedef struct _JSONOutputRanges
+{
+  JSONOutputRange* slots;
+  size_t slotsCount, rangesCount;             // Power of 2 slots
+}
+JSONOutputRanges;
+
+static inline size_t JSON_HashContainer( const JSONNode container )
+{
+  unsigned long long hash = (unsigned long long) (uintptr_t) container * 0x9E3779B97F4A7C15ULL;
+  return (size_t) ( hash >> 32 );
+}
+
+static inline JSONOutputRange* JSON_FindOutputSlot( JSONOutputRanges* ranges, const JSONNode container )
+{
+  size_t slotMask = ranges->slotsCount - 1;
+  size_t slot = JSON_HashContainer( container ) & slotMask;
+  while( ranges->slots[ slot ].container != NULL && ranges->slots[ slot ].container != container ) slot = ( slot + 1 ) & slotMask;
+  return &(ranges->slots[ slot ]);
+}
+
+// Range of given container, added with zero offset and length if not found. NULL if the table can't grow
+static JSONOutputRange* JSON_GetOutputRange( JSONOutputRanges* ranges, const JSONNode container )
+{
+  if( ranges->slotsCount > 0 ) 
+  {
+    JSONOutputRange* range = JSON_FindOutputSlot( ranges, container );
+    if( range->container != NULL ) return range;
+  }
+  if( 2 * ( ranges->rangesCount + 1 ) > ranges->slotsCount ) 
+  {
+    JSONOutputRanges newRanges = { .slotsCount = ( ranges->slotsCount > 0 ) ? 2 * ranges->slotsCount : 64, .rangesCount = ranges->rangesCount };
+    newRanges.slots = (JSONOutputRange*) JSON_AllocateHeap( newRanges.slotsCount * sizeof(JSONOutputRange) );
+    if( newRanges.slots == NULL ) return NULL;
+    memset( newRanges.slots, 0, newRanges.slotsCount * sizeof(JSONOutputRange) );
+    for( size_t slot = 0; slot < ranges->slotsCount; slot++ ) 
+    {
+      if( ranges->slots[ slot ].container != NULL ) 
+        *JSON_FindOutputSlot( &newRanges, ranges->slots[ slot ].container ) = ranges->slots[ slot ];
+    }
+    JSON_FreeHeap( ranges->slots, ranges->slotsCount * sizeof(JSONOutputRange) );
+    *ranges = newRanges;
+  }
+  JSONOutputRange* range = JSON_FindOutputSlot( ranges, container );
+  *range = (JSONOutputRange) { .container = container, .offset = 0, .length = 0 };
+  ranges->rangesCount++;
+  return range;
+}
+
+// Forget all ranges, keeping table memory. Ranges of released containers are only dropped here, 
+// as nodes reusing their memory are never marked as cached before being written again
+static void JSON_ClearOutputRanges( JSONOutputRanges* ranges )
+{
+  if( ranges->rangesCount > 0 ) memset( ranges->slots, 0, ranges->slotsCount * sizeof(JSONOutputRange) );
+  ranges->rangesCount = 0;
+}
+
+// Output destination: fixed caller buffer, growable heap buffer, or chunk flushed to a file/descriptor
+typedef struct _JSONWriter
+{
+  char* buffer;
+  size_t capacity, length;                    // Usable size (without terminator) and filled size of buffer
+  size_t totalLength;                         // Size of the whole output, including discarded parts
+  bool isGrowable;
+  JSONOutputRanges* outputRanges;             // Where output range of each container is recorded for later reuse. NULL if not caching
+  unsigned int outputBit;                     // Bit of the cache in cachedOutputs of written containers
+  const char* cachedOutput;                   // Output of last cached write, from where unchanged containers are copied
+  int (*flush)( struct _JSONWriter* writer );
+  union 
+  {
+    FILE* file;
+    int fileDescriptor;
+  };
+  int error;
+}
+JSONWriter;
+
+static void JSON_WriteData( JSONWriter* writer, const char* data, size_t length )
+{
+  writer->totalLength += length;
+  while( length > 0 && writer->error == JSON_OK )
+  {
+    if( writer->length == writer->capacity ) 
+    {
+      if( writer->flush != NULL ) writer->error = writer->flush( writer );
+      else if( writer->isGrowable )
+      {
+        size_t newCapacity = 2 * writer->capacity + length;
+        char* newBuffer = (char*) JSON_ResizeHeap( writer->buffer, writer->capacity + 1, newCapacity + 1 );
+        if( newBuffer == NULL ) 
+        {
+          writer->error = JSON_ERROR_NO_SPACE;
+          return;
+        }
+        writer->buffer = newBuffer;
+        writer->capacity = newCapacity;
+      }
+      else return;                            // Fixed buffer is full: only count remaining size
+      continue;
+    }
+    size_t copyLength = writer->capacity - writer->length;
+    if( copyLength > length ) copyLength = length;
+    memcpy( writer->buffer + writer->length, data, copyLength );
+    writer->length += copyLength;
+    data += copyLength;
+    length -= copyLength;
+  }
+}
+
+static void JSON_WriteIndentation( JSONWriter* writer, int depth )
+{
+  static const char SPACES[] = "                                                                ";
+  size_t paddingLength = 2 * (size_t) depth;
+  while( paddingLength > 0 )
+  {
+    size_t writeLength = ( paddingLength < sizeof(SPACES) - 1 ) ? paddingLength : sizeof(SPACES) - 1;
+    JSON_WriteData( writer, SPACES, writeLength );
+    paddingLength -= writeLength;
+  }
+}
+
+static void JSON_WriteKey( JSONWriter* writer, const JSONNode root )
+{
+  if( root->key == NULL ) return;
+  JSON_WriteData( writer, "\"", 1 );
+  JSON_WriteData( writer, root->key, root->keyLength );
+  JSON_WriteData( writer, "\":", 2 );
+}
+
+static void JSON_WriteValue( JSONWriter* writer, const JSONNode root, int depth )
+{
+  if( depth > 0 ) JSON_WriteIndentation( writer, depth );
+  JSON_WriteKey( writer, root );
+  if( JSON_IS_INTERNAL( root ) ) 
+  {
+    JSON_WriteData( writer, ( root->type == JSON_TYPE_BRACKET ) ? "[" : "{", 1 );
+    if( root->size && depth >= 0 ) JSON_WriteData( writer, "\n", 1 );   // Children in separate lines for idented mode
+  } 
+  else 
+  {
+    if( root->type == JSON_TYPE_STRING ) JSON_WriteData( writer, "\"", 1 );
+    if( root->flags & JSON_TEXT_STALE ) 
+    {
+      char numberBuffer[ JSON_NUMBER_MAX_LENGTH ];
+      JSON_WriteData( writer, numberBuffer, JSON_FormatCachedNumber( root, numberBuffer ) );
+    }
+    else if( root->value ) JSON_WriteData( writer, root->value, (size_t) root->size );
+    if( root->type == JSON_TYPE_STRING ) JSON_WriteData( writer, "\"", 1 );
+  }
+}
+
+static void JSON_WriteContainerEnd( JSONWriter* writer, const JSONNode root, int depth )
+{
+  if( root->size && depth > 0 ) JSON_WriteIndentation( writer, depth );
+  JSON_WriteData( writer, ( root->type == JSON_TYPE_BRACKET ) ? "]" : "}", 1 );
+}
+
+typedef struct _JSONWriterFrame
+{
+  JSONNode container;
+  size_t childIndex;                          // Child currently being written
+  size_t outputStart, cachedStart;            // Container position in current and last cached output
+}
+JSONWriterFrame;
+
+static inline void JSON_CacheOutput( JSONWriter* writer, JSONNode container, size_t outputStart )
+{
+  if( writer->outputRanges == NULL || ( container->flags & JSON_FROZEN ) ) return;
+  JSONOutputRange* range = JSON_GetOutputRange( writer->outputRanges, container );     // Added when the container was started
+  range->length = (unsigned int) ( writer->length - outputStart );
+  container->cachedOutputs |= writer->outputBit;
+}
+
+// Depth first traversal with explicit stack of containers, so that depth is limited only by memory
+static void JSON_WriteNode( JSONWriter* writer, const JSONNode root, int depth )
+{
+  JSONWriterFrame localStack[ JSON_WRITER_STACK_SIZE ];
+  JSONWriterFrame* containersStack = localStack;
+  size_t stackSize = JSON_WRITER_STACK_SIZE, level = 0;
+  unsigned long long startTime = JSON_GetTime();
+  JSONNode node = root;
+  while( writer->error == JSON_OK ) 
+  {
+    int nodeDepth = ( depth >= 0 ) ? depth + (int) level : -1;
+    size_t outputStart = writer->length, cachedStart = 0;
+    bool isCopied = false;
+    if( writer->outputRanges != NULL && JSON_IS_INTERNAL( node ) && !( node->flags & JSON_FROZEN ) )    // Frozen nodes are not written to
+    {
+      JSONOutputRange* range = JSON_GetOutputRange( writer->outputRanges, node );
+      if( range == NULL ) 
+      {
+        writer->error = JSON_ERROR_NO_SPACE;
+        break;
+      }
+      // Offsets are relative to the parent container, so that they stay valid when any enclosing container is copied
+      if( level > 0 ) 
+      {
+        cachedStart = containersStack[ level - 1 ].cachedStart + range->offset;
+        range->offset = (unsigned int) ( outputStart - containersStack[ level - 1 ].outputStart );
+      }
+      if( writer->cachedOutput != NULL && ( node->cachedOutputs & writer->outputBit ) ) 
+      {
+        JSON_WriteData( writer, writer->cachedOutput + cachedStart, range->length );
+        isCopied = true;
+      }
+    }
+    if( !isCopied && ( node->flags & JSON_CHILDREN_PENDING ) ) 
+    {
+      // Unread container is written back as found in the source, also when there is no memory to read it
+      if( depth < 0 || ( !JSON_LoadChildren( node ) && ( node->flags & JSON_CHILDREN_PENDING ) ) ) 
+      {
+        JSON_WriteKey( writer, node );
+        JSON_WriteData( writer, node->value, node->capacity );
+        isCopied = true;
+      }
+    }
+    if( !isCopied ) 
+    {
+      JSON_WriteValue( writer, node, nodeDepth );
+      if( JSON_IS_INTERNAL( node ) && node->size > 0 ) 
+      {
+        if( level >= stackSize ) 
+        {
+          JSONWriterFrame* newStack = (JSONWriterFrame*) JSON_AllocateHeap( 2 * stackSize * sizeof(JSONWriterFrame) );
+          if( newStack == NULL ) 
+          {
+            writer->error = JSON_ERROR_NO_SPACE;
+            break;
+          }
+          memcpy( newStack, containersStack, level * sizeof(JSONWriterFrame) );
+          if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONWriterFrame) );
+          containersStack = newStack;
+          stackSize *= 2;
+        }
+        containersStack[ level ] = (JSONWriterFrame) { .container = node, .childIndex = 0, .outputStart = outputStart, .cachedStart = cachedStart };
+        level++;
+        node = node->childrenList[ 0 ];
+        continue;
+      }
+      if( JSON_IS_INTERNAL( node ) ) 
+      {
+        JSON_WriteContainerEnd( writer, node, nodeDepth );
+        JSON_CacheOutput( writer, node, outputStart );
+      }
+    }
+    // Close finished containers, until one with children left is found
+    node = NULL;
+    while( level > 0 && node == NULL ) 
+    {
+      JSONWriterFrame* frame = &(containersStack[ level - 1 ]);
+      int frameDepth = ( depth >= 0 ) ? depth + (int) level - 1 : -1;
+      if( ++frame->childIndex < frame->container->size ) 
+      {
+        JSON_WriteData( writer, ",", 1 );
+        node = frame->container->childrenList[ frame->childIndex ];
+      }
+      if( depth >= 0 ) JSON_WriteData( writer, "\n", 1 );
+      if( node == NULL ) 
+      {
+        JSON_WriteContainerEnd( writer, frame->container, frameDepth );
+        JSON_CacheOutput( writer, frame->container, frame->outputStart );
+        level--;
+      }
+    }
+    if( node == NULL ) break;
+  }
+  if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONWriterFrame) );
+  JSON_ADD_COUNTER( counters.serializeTime, JSON_GetTime() - startTime );
+}
+
+static int JSON_FlushToFile( JSONWriter* writer )
+{
+  size_t bufferLength = writer->length;
+  writer->length = 0;
+  return ( fwrite( writer->buffer, 1, bufferLength, writer->file ) == bufferLength ) ? JSON_OK : JSON_ERROR_OUTPUT;
+}
+
+static int JSON_FlushToFileDescriptor( JSONWriter* writer )
+{
+#ifdef JSON_USE_POSIX
+  const char* data = writer->buffer;
+  size_t remainingLength = writer->length;
+  writer->length = 0;
+  while( remainingLength > 0 )
+  {
+    ssize_t writtenLength = write( writer->fileDescriptor, data, remainingLength );
+    if( writtenLength < 0 && errno == EINTR ) continue;
+    if( writtenLength <= 0 ) return JSON_ERROR_OUTPUT;
+    data += writtenLength;
+    remainingLength -= (size_t) writtenLength;
+  }
+  return JSON_OK;
+#else
+  writer->length = 0;
+  return JSON_ERROR_OUTPUT;
+#endif
+}
+
+// Stream whole tree through a fixed size chunk on the stack
+static int JSON_WriteChunked( const JSONNode root, int mode, JSONWriter* writer )
+{
+  char chunk[ JSON_WRITER_CHUNK_SIZE ];
+  writer->buffer = chunk;
+  writer->capacity = sizeof(chunk);
+  JSON_WriteNode( writer, root, mode );
+  if( writer->error == JSON_OK && writer->length > 0 ) writer->error = writer->flush( writer );
+  return writer->error;
+}
+
+int JSON_WriteToBuffer( const JSONNode root, int mode, char* buffer, size_t capacity, size_t* ref_neededSize )
+{
+  JSONWriter writer = { .buffer = buffer, .capacity = ( capacity > 0 ) ? capacity - 1 : 0 };
+  if( root != NULL ) JSON_WriteNode( &writer, root, mode );
+  if( capacity > 0 ) buffer[ writer.length ] = '\0';
+  if( ref_neededSize != NULL ) *ref_neededSize = writer.totalLength + 1;
+  return ( writer.error == JSON_OK && writer.length == writer.totalLength && capacity > 0 ) ? JSON_OK : JSON_ERROR_NO_SPACE;
+}
+
+int JSON_WriteToFile( const JSONNode root, int mode, FILE* file )
+{
+  if( root == NULL || file == NULL ) return JSON_ERROR_OUTPUT;
+  JSONWriter writer = { .flush = JSON_FlushToFile, .file = file };
+  return JSON_WriteChunked( root, mode, &writer );
+}
+
+int JSON_WriteToFd( const JSONNode root, int mode, int fileDescriptor )
+{
+  if( root == NULL || fileDescriptor < 0 ) return JSON_ERROR_OUTPUT;
+  JSONWriter writer = { .flush = JSON_FlushToFileDescriptor, .fileDescriptor = fileDescriptor };
+  return JSON_WriteChunked( root, mode, &writer );
+}
+
+char* JSON_GetString( const JSONNode root, int mode )
+{
+  JSONWriter writer = { .capacity = 256, .isGrowable = true };
+  writer.buffer = (char*) JSON_AllocateHeap( writer.capacity + 1 );    // Allocate memory for null terminator
+  if( writer.buffer == NULL ) return NULL;
+  JSON_WriteNode( &writer, root, mode );
+  if( writer.error != JSON_OK ) 
+  {
+    JSON_FreeHeap( writer.buffer, writer.capacity + 1 );
+    return NULL;
+  }
+  writer.buffer[ writer.length ] = '\0';
+  JSON_CountBytes( 0, writer.capacity + 1 );      // Returned string is owned (and released) by the caller
+  return writer.buffer;
+}
+
+struct _JSONCacheData
+{
+  int mode;
+  JSONNode root;                              // Tree whose container ranges refer to current output. NULL to write from scratch
+  char* buffersList[ 2 ];                     // Current output, and spare buffer for the next one
+  size_t capacitiesList[ 2 ];
+  int currentIndex;
+  JSONOutputRanges outputRanges;              // Ranges of containers of the tree in current output
+  size_t writtenRangesCount;                  // Ranges after last write from scratch, to bound those left by released containers
+  unsigned int outputBit;                     // Bit of the cache in cachedOutputs of nodes. 0 if all are taken, so that trees are always written from scratch
+};
+
+static unsigned int cachesBits;               // Bits of cachedOutputs taken by existing caches
+
+static unsigned int JSON_AcquireCacheBit( void )
+{
+  unsigned int usedBits = JSON_LOAD_SHARED( cachesBits );
+  while( true ) 
+  {
+    unsigned int freeBits = ~usedBits & ( ( 1U << JSON_CACHES_MAX ) - 1 );
+    if( freeBits == 0 ) return 0;
+    unsigned int bit = freeBits & ( 0U - freeBits );        // Lowest free bit
+    if( JSON_SWAP_SHARED( cachesBits, &usedBits, usedBits | bit ) ) return bit;
+  }
+}
+
+JSONCache JSON_CreateCache( int mode )
+{
+  JSONCache newCache = (JSONCache) JSON_AllocateHeap( sizeof(JSONCacheData) );
+  if( newCache == NULL ) return NULL;
+  memset( newCache, 0, sizeof(JSONCacheData) );
+  newCache->mode = mode;
+  // Nodes may keep the bit of a destroyed cache, but no ranges of a new cache before it writes them from scratch
+  newCache->outputBit = JSON_AcquireCacheBit();
+  return newCache;
+}
+
+const char* JSON_WriteCached( JSONCache cache, const JSONNode root, size_t* ref_length )
+{
+  if( cache == NULL || root == NULL ) return NULL;
+  int spareIndex = 1 - cache->currentIndex;
+  JSONWriter writer = { .buffer = cache->buffersList[ spareIndex ], .capacity = cache->capacitiesList[ spareIndex ], .isGrowable = true, 
+                        .outputRanges = ( cache->outputBit != 0 ) ? &(cache->outputRanges) : NULL, .outputBit = cache->outputBit };
+  if( writer.buffer == NULL ) 
+  {
+    writer.buffer = (char*) JSON_AllocateHeap( 256 + 1 );
+    if( writer.buffer == NULL ) return NULL;
+    writer.capacity = 256;
+  }
+  bool isOutdated = ( cache->outputRanges.rangesCount > 2 * cache->writtenRangesCount + 64 );
+  writer.cachedOutput = ( root == cache->root && !isOutdated ) ? cache->buffersList[ cache->currentIndex ] : NULL;
+  if( writer.cachedOutput == NULL ) JSON_ClearOutputRanges( &(cache->outputRanges) );
+  JSON_WriteNode( &writer, root, cache->mode );
+  if( writer.cachedOutput == NULL ) cache->writtenRangesCount = cache->outputRanges.rangesCount;
+  cache->buffersList[ spareIndex ] = writer.buffer;
+  cache->capacitiesList[ spareIndex ] = writer.capacity;
+  // Recorded ranges are not reliable after failures, or with offsets beyond 32 bits
+  cache->root = ( writer.error == JSON_OK && writer.length <= UINT_MAX ) ? root : NULL;
+  if( writer.error != JSON_OK ) return NULL;
+  writer.buffer[ writer.length ] = '\0';
+  cache->currentIndex = spareIndex;
+  if( ref_length != NULL ) *ref_length = writer.length;
+  return writer.buffer;
+}
+
+void JSON_DestroyCache( JSONCache cache )
+{
+  if( cache == NULL ) return;
+  for( int bufferIndex = 0; bufferIndex < 2; bufferIndex++ )
+    JSON_FreeHeap( cache->buffersList[ bufferIndex ], cache->capacitiesList[ bufferIndex ] + 1 );
+  JSON_FreeHeap( cache->outputRanges.slots, cache->outputRanges.slotsCount * sizeof(JSONOutputRange) );
+  JSON_ADD_SHARED( cachesBits, 0U - cache->outputBit );
+  JSON_FreeHeap( cache, sizeof(JSONCacheData) );
+}
+
+void JSON_Print( const JSONNode root )
+{
+  JSON_WriteToFile( root, JSON_FORMAT_IDENT, stdout );
+  putchar( '\n' );
+}
+
+typedef struct _JSONStructReader
+{
+  const char* end;
+  const JSONScanner* scanner;
+}
+JSONStructReader;
+
+// Read string (without quotes) or bare token, leaving position after it
+static bool JSON_ReadStructToken( JSONStructReader* reader, const char** ref_data, const char** ref_token, size_t* ref_length, bool* ref_isString )
+{
+  const char* data = JSON_SkipSpaces( reader->scanner, *ref_data, reader->end );
+  if( data >= reader->end ) return false;
+  *ref_isString = ( *data == '"' || *data == '\'' );
+  if( *ref_isString ) 
+  {
+    *ref_token = data + 1;
+    data = reader->scanner->findStringEnd( *ref_token, reader->end, *data );
+    if( data >= reader->end ) return false;                 // Missing closing quote
+    *ref_length = data++ - *ref_token;
+  }
+  else
+  {
+    *ref_token = data;
+    data = reader->scanner->findTokenEnd( data, reader->end );
+    *ref_length = data - *ref_token;
+    if( *ref_length == 0 ) return false;
+  }
+  *ref_data = data;
+  return true;
+}
+
+// Check for given delimiter after optional whitespace, consuming it if found
+static bool JSON_ReadStructDelimiter( JSONStructReader* reader, const char** ref_data, char delimiter )
+{
+  const char* data = JSON_SkipSpaces( reader->scanner, *ref_data, reader->end );
+  if( data >= reader->end || *data != delimiter ) return false;
+  *ref_data = data + 1;
+  return true;
+}
+
+static bool JSON_StoreInteger( char* target, size_t size, long long value )
+{
+  if( size == sizeof(signed char) && value >= SCHAR_MIN && value <= SCHAR_MAX ) *((signed char*) target) = (signed char) value;
+  else if( size == sizeof(short) && value >= SHRT_MIN && value <= SHRT_MAX ) *((short*) target) = (short) value;
+  else if( size == sizeof(int) && value >= INT_MIN && value <= INT_MAX ) *((int*) target) = (int) value;
+  else if( size == sizeof(long long) ) *((long long*) target) = value;
+  else return false;
+  return true;
+}
+
+static long long JSON_LoadInteger( const char* source, size_t size )
+{
+  if( size == sizeof(signed char) ) return *((const signed char*) source);
+  else if( size == sizeof(short) ) return *((const short*) source);
+  else if( size == sizeof(int) ) return *((const int*) source);
+  return *((const long long*) source);
+}
+
+static int JSON_DecodeObject( JSONStructReader* reader, const char** ref_data, const JSONField* descriptor, char* structData );
+
+static int JSON_DecodeItem( JSONStructReader* reader, const char** ref_data, const JSONField* field, char* target )
+{
+  const char* data = JSON_SkipSpaces( reader->scanner, *ref_data, reader->end );
+  if( field->type == JSON_FIELD_STRUCT && data < reader->end && *data == '{' ) 
+    return JSON_DecodeObject( reader, ref_data, field->fields, target );
+  const char* token;
+  size_t length;
+  bool isString;
+  if( !JSON_ReadStructToken( reader, &data, &token, &length, &isString ) ) return JSON_ERROR_NO_VALUE;
+  *ref_data = data;
+  const char* literal = NULL;
+  enum JSONNodeType type = isString ? JSON_TYPE_STRING : JSON_ReadBareToken( token, &length, &literal );
+  if( type == JSON_TYPE_NULL ) return JSON_OK;                        // Null values leave fields unchanged
+  if( field->type == JSON_FIELD_STRING && type == JSON_TYPE_STRING ) 
+  {
+    if( length >= field->size ) return JSON_ERROR_NO_SPACE;
+    memcpy( target, token, length );
+    target[ length ] = '\0';
+  }
+  else if( field->type == JSON_FIELD_BOOL && type == JSON_TYPE_BOOLEAN ) 
+  {
+    *((bool*) target) = ( literal == TRUE_STR );
+  }
+  else if( ( field->type == JSON_FIELD_INT || field->type == JSON_FIELD_DOUBLE ) && type == JSON_TYPE_NUMBER ) 
+  {
+    long long integer = 0;
+    double real = 0.0;
+    int numberClass = JSON_ReadNumber( token, length, &integer, &real );
+    if( numberClass == JSON_READ_INVALID ) return JSON_ERROR_INVALID_NUMBER;
+    if( numberClass == JSON_READ_UNCONVERTED )             // Rare long or extreme numbers, converted from a bounded copy
+    {
+      char numberBuffer[ 64 ];
+      if( length >= sizeof(numberBuffer) ) return JSON_ERROR_INVALID_NUMBER;
+      memcpy( numberBuffer, token, length );
+      numberBuffer[ length ] = '\0';
+      real = strtod( numberBuffer, NULL );
+      numberClass = JSON_READ_REAL;
+    }
+    if( field->type == JSON_FIELD_DOUBLE ) 
+    {
+      if( numberClass == JSON_READ_INTEGER ) real = (double) integer;
+      if( field->size == sizeof(float) ) *((float*) target) = (float) real;
+      else *((double*) target) = real;
+    }
+    else
+    {
+      // Integral reals (e.g. 1e3) are accepted for integer fields
+      if( numberClass == JSON_READ_REAL ) 
+      {
+        if( !( real >= (double) LLONG_MIN && real < (double) LLONG_MAX ) || real != (double) (long long) real ) return JSON_ERROR_INVALID_NUMBER;
+        integer = (long long) real;
+      }
+      if( !JSON_StoreInteger( target, field->size, integer ) ) return JSON_ERROR_INVALID_NUMBER;
+    }
+  }
+  else return JSON_ERROR_UNEXPECTED;                                   // Value type does not match field
+  return JSON_OK;
+}
+
+static int JSON_DecodeField( JSONStructReader* reader, const char** ref_data, const JSONField* field, char* structData )
+{
+  char* target = structData + field->offset;
+  if( field->maxCount == 0 ) return JSON_DecodeItem( reader, ref_data, field, target );
+  if( !JSON_ReadStructDelimiter( reader, ref_data, '[' ) ) 
+  {
+    const char* token;
+    size_t length;
+    bool isString;
+    const char* literal = NULL;
+    if( !JSON_ReadStructToken( reader, ref_data, &token, &length, &isString ) ) return JSON_ERROR_NO_VALUE;
+    return ( !isString && JSON_ReadBareToken( token, &length, &literal ) == JSON_TYPE_NULL ) ? JSON_OK : JSON_ERROR_UNEXPECTED;
+  }
+  size_t elementsCount = 0;
+  if( !JSON_ReadStructDelimiter( reader, ref_data, ']' ) ) 
+  {
+    do
+    {
+      if( elementsCount >= field->maxCount ) return JSON_ERROR_NO_SPACE;
+      int error = JSON_DecodeItem( reader, ref_data, field, target + elementsCount * field->size );
+      if( error != JSON_OK ) return error;
+      elementsCount++;
+    } 
+    while( JSON_ReadStructDelimiter( reader, ref_data, ',' ) );
+    if( !JSON_ReadStructDelimiter( reader, ref_data, ']' ) ) return JSON_ERROR_UNEXPECTED;
+  }
+  memcpy( structData + field->countOffset, &elementsCount, sizeof(size_t) );
+  return JSON_OK;
+}
+
+// Find descriptor entry for given key, starting after the last one found, as members usually come in table order
+static const JSONField* JSON_FindField( const JSONField* descriptor, const JSONField** ref_nextField, const char* key, size_t keyLength )
+{
+  if( (*ref_nextField)->key == NULL ) *ref_nextField = descriptor;
+  const JSONField* field = *ref_nextField;
+  do
+  {
+    if( field->key == NULL ) field = descriptor;
+    else 
+    {
+      if( strncmp( field->key, key, keyLength ) == 0 && field->key[ keyLength ] == '\0' ) 
+      {
+        *ref_nextField = field + 1;
+        return field;
+      }
+      field++;
+    }
+  } 
+  while( field != *ref_nextField );
+  return NULL;
+}
+
+static int JSON_DecodeObject( JSONStructReader* reader, const char** ref_data, const JSONField* descriptor, char* structData )
+{
+  if( !JSON_ReadStructDelimiter( reader, ref_data, '{' ) ) return JSON_ERROR_UNEXPECTED;
+  if( JSON_ReadStructDelimiter( reader, ref_data, '}' ) ) return JSON_OK;
+  const JSONField* nextField = descriptor;
+  do
+  {
+    const char* key;
+    size_t keyLength;
+    bool isString;
+    if( !JSON_ReadStructToken( reader, ref_data, &key, &keyLength, &isString ) ) return JSON_ERROR_NO_KEY;
+    if( !JSON_ReadStructDelimiter( reader, ref_data, ':' ) ) return JSON_ERROR_NO_KEY;
+    const JSONField* field = JSON_FindField( descriptor, &nextField, key, keyLength );
+    if( field != NULL ) 
+    {
+      int error = JSON_DecodeField( reader, ref_data, field, structData );
+      if( error != JSON_OK ) return error;
+    }
+    else                                                                // Skip value of unknown key
+    {
+      const char* data = JSON_SkipSpaces( reader->scanner, *ref_data, reader->end );
+      if( data < reader->end && ( *data == '[' || *data == '{' ) ) 
+      {
+        if( ( *ref_data = JSON_SkipContainer( reader->scanner, data, reader->end ) ) == NULL ) return JSON_ERROR_UNEXPECTED;
+      }
+      else if( !JSON_ReadStructToken( reader, ref_data, &key, &keyLength, &isString ) ) return JSON_ERROR_NO_VALUE;
+    }
+  } 
+  while( JSON_ReadStructDelimiter( reader, ref_data, ',' ) );
+  return JSON_ReadStructDelimiter( reader, ref_data, '}' ) ? JSON_OK : JSON_ERROR_UNEXPECTED;
+}
+
+int JSON_DecodeStruct( const char* jsonData, size_t length, const JSONField* descriptor, void* ref_structData )
+{
+  if( jsonData == NULL || descriptor == NULL || ref_structData == NULL ) return JSON_ERROR_NO_VALUE;
+  unsigned long long startTime = JSON_GetTime();
+  JSONStructReader reader = { .end = jsonData + length, .scanner = JSON_GetScanner() };
+  int error = JSON_DecodeObject( &reader, &jsonData, descriptor, (char*) ref_structData );
+  if( error == JSON_OK && JSON_SkipSpaces( reader.scanner, jsonData, reader.end ) < reader.end ) error = JSON_ERROR_UNEXPECTED;
+  JSON_ADD_COUNTER( counters.parseTime, JSON_GetTime() - startTime );
+  return error;
+}
+
+static void JSON_EncodeObject( JSONWriter* writer, const JSONField* descriptor, const char* structData );
+
+static void JSON_EncodeItem( JSONWriter* writer, const JSONField* field, const char* source )
+{
+  char numberBuffer[ JSON_NUMBER_MAX_LENGTH ];
+  size_t length = 0;
+  switch( field->type ) 
+  {
+    case JSON_FIELD_DOUBLE:
+      if( field->size == sizeof(float) ) length = JSON_FormatFloat( numberBuffer, *((const float*) source) );
+      else length = JSON_FormatNumber( numberBuffer, *((const double*) source) );
+      JSON_WriteData( writer, numberBuffer, length );
+      break;
+    case JSON_FIELD_INT:
+      JSON_WriteData( writer, numberBuffer, JSON_FormatInteger( numberBuffer, JSON_LoadInteger( source, field->size ) ) );
+      break;
+    case JSON_FIELD_BOOL:
+      if( *((const bool*) source) ) JSON_WriteData( writer, TRUE_STR, 4 );
+      else JSON_WriteData( writer, FALSE_STR, 5 );
+      break;
+    case JSON_FIELD_STRING:
+      while( length < field->size && source[ length ] != '\0' ) length++;
+      JSON_WriteData( writer, "\"", 1 );
+      JSON_WriteData( writer, source, length );
+      JSON_WriteData( writer, "\"", 1 );
+      break;
+    case JSON_FIELD_STRUCT:
+      JSON_EncodeObject( writer, field->fields, source );
+      break;
+  }
+}
+
+static void JSON_EncodeObject( JSONWriter* writer, const JSONField* descriptor, const char* structData )
+{
+  JSON_WriteData( writer, "{", 1 );
+  for( const JSONField* field = descriptor; field->key != NULL; field++ ) 
+  {
+    if( field != descriptor ) JSON_WriteData( writer, ",", 1 );
+    JSON_WriteData( writer, "\"", 1 );
+    JSON_WriteData( writer, field->key, strlen( field->key ) );
+    JSON_WriteData( writer, "\":", 2 );
+    const char* source = structData + field->offset;
+    if( field->maxCount == 0 ) JSON_EncodeItem( writer, field, source );
+    else
+    {
+      size_t elementsCount;
+      memcpy( &elementsCount, structData + field->countOffset, sizeof(size_t) );
+      if( elementsCount > field->maxCount ) elementsCount = field->maxCount;
+      JSON_WriteData( writer, "[", 1 );
+      for( size_t elementIndex = 0; elementIndex < elementsCount; elementIndex++ ) 
+      {
+        if( elementIndex > 0 ) JSON_WriteData( writer, ",", 1 );
+        JSON_EncodeItem( writer, field, source + elementIndex * field->size );
+      }
+      JSON_WriteData( writer, "]", 1 );
+    }
+  }
+  JSON_WriteData( writer, "}", 1 );
+}
+
+int JSON_EncodeStruct( const void* structData, const JSONField* descriptor, char* buffer, size_t capacity )
+{
+  if( structData == NULL || descriptor == NULL || buffer == NULL ) return JSON_ERROR_NO_VALUE;
+  unsigned long long startTime = JSON_GetTime();
+  JSONWriter writer = { .buffer = buffer, .capacity = ( capacity > 0 ) ? capacity - 1 : 0 };
+  JSON_EncodeObject( &writer, descriptor, (const char*) structData );
+  if( capacity > 0 ) buffer[ writer.length ] = '\0';
+  JSON_ADD_COUNTER( counters.serializeTime, JSON_GetTime() - startTime );
+  return ( writer.length == writer.totalLength && capacity > 0 ) ? JSON_OK : JSON_ERROR_NO_SPACE;
+}
+
+// CBOR (RFC 8949) major types, in the 3 high bits of each item initial byte
+enum { JSON_CBOR_UNSIGNED, JSON_CBOR_NEGATIVE, JSON_CBOR_BYTES, JSON_CBOR_TEXT, JSON_CBOR_ARRAY, JSON_CBOR_MAP, JSON_CBOR_TAG, JSON_CBOR_SIMPLE };
+
+#define JSON_CBOR_FALSE       0xF4
+#define JSON_CBOR_TRUE        0xF5
+#define JSON_CBOR_NULL        0xF6
+#define JSON_CBOR_UNDEFINED   0xF7
+#define JSON_CBOR_HALF        0xF9
+#define JSON_CBOR_FLOAT       0xFA
+#define JSON_CBOR_DOUBLE      0xFB
+
+#define JSON_CBOR_INTEGER_MAX   1e15    // Integral doubles below this magnitude are written as integers, as in JSON_FormatNumber
+
+static void JSON_WriteCBORBytes( JSONWriter* writer, unsigned char initialByte, unsigned long long value, size_t valueSize )
+{
+  unsigned char itemData[ 9 ] = { initialByte };
+  for( size_t byteIndex = valueSize; byteIndex > 0; byteIndex-- )      // Big endian
+  {
+    itemData[ byteIndex ] = (unsigned char) value;
+    value >>= 8;
+  }
+  JSON_WriteData( writer, (const char*) itemData, valueSize + 1 );
+}
+
+// Write item head with the shortest argument encoding: value for integers, length for strings, children count for containers
+static void JSON_WriteCBORHead( JSONWriter* writer, int majorType, unsigned long long argument )
+{
+  unsigned char initialByte = (unsigned char) ( majorType << 5 );
+  if( argument < 24 ) JSON_WriteCBORBytes( writer, initialByte | (unsigned char) argument, 0, 0 );
+  else if( argument <= 0xFF ) JSON_WriteCBORBytes( writer, initialByte | 24, argument, 1 );
+  else if( argument <= 0xFFFF ) JSON_WriteCBORBytes( writer, initialByte | 25, argument, 2 );
+  else if( argument <= 0xFFFFFFFFull ) JSON_WriteCBORBytes( writer, initialByte | 26, argument, 4 );
+  else JSON_WriteCBORBytes( writer, initialByte | 27, argument, 8 );
+}
+
+static void JSON_WriteCBORNumber( JSONWriter* writer, JSONNode node )
+{
+  if( !( node->flags & JSON_NUMBER_CACHED ) && node->value != NULL ) 
+  {
+    JSON_CacheNumber( node, true );
+    if( !( node->flags & JSON_NUMBER_CACHED ) ) 
+    {
+      writer->error = JSON_ERROR_NO_SPACE;
+      return;
+    }
+  }
+  long long integer = 0;
+  if( node->flags & JSON_NUMBER_INTEGER ) integer = node->integer;
+  else if( node->flags & JSON_NUMBER_CACHED ) 
+  {
+    double number = node->number;
+    // Negative zero is kept as floating point, like in text
+    if( !( number > -JSON_CBOR_INTEGER_MAX && number < JSON_CBOR_INTEGER_MAX && number == (double) (long long) number ) || ( number == 0.0 && signbit( number ) ) ) 
+    {
+      float singleNumber = (float) number;
+      if( singleNumber == number || isnan( number ) )       // Single precision when exact
+      {
+        uint32_t bits;
+        memcpy( &bits, &singleNumber, sizeof(bits) );
+        JSON_WriteCBORBytes( writer, JSON_CBOR_FLOAT, bits, sizeof(bits) );
+      }
+      else
+      {
+        uint64_t bits;
+        memcpy( &bits, &number, sizeof(bits) );
+        JSON_WriteCBORBytes( writer, JSON_CBOR_DOUBLE, bits, sizeof(bits) );
+      }
+      return;
+    }
+    integer = (long long) number;
+  }
+  if( integer >= 0 ) JSON_WriteCBORHead( writer, JSON_CBOR_UNSIGNED, (unsigned long long) integer );
+  else JSON_WriteCBORHead( writer, JSON_CBOR_NEGATIVE, (unsigned long long) ( -1 - integer ) );   // Encoded as -1 - n
+}
+
+// Pre-order traversal with explicit stack. Containers are prefixed with their children count, so nothing is written when they end
+static void JSON_WriteCBORNode( JSONWriter* writer, const JSONNode root )
+{
+  JSONWriterFrame localStack[ JSON_WRITER_STACK_SIZE ];
+  JSONWriterFrame* containersStack = localStack;
+  size_t stackSize = JSON_WRITER_STACK_SIZE, level = 0;
+  unsigned long long startTime = JSON_GetTime();
+  JSONNode node = root;
+  while( node != NULL && writer->error == JSON_OK ) 
+  {
+    if( level > 0 && containersStack[ level - 1 ].container->type == JSON_TYPE_BRACE ) 
+    {
+      JSON_WriteCBORHead( writer, JSON_CBOR_TEXT, node->keyLength );
+      if( node->key != NULL ) JSON_WriteData( writer, node->key, node->keyLength );
+    }
+    if( node->type == JSON_TYPE_NULL ) JSON_WriteCBORBytes( writer, JSON_CBOR_NULL, 0, 0 );
+    else if( node->type == JSON_TYPE_BOOLEAN ) JSON_WriteCBORBytes( writer, ( node->value == TRUE_STR ) ? JSON_CBOR_TRUE : JSON_CBOR_FALSE, 0, 0 );
+    else if( node->type == JSON_TYPE_NUMBER ) JSON_WriteCBORNumber( writer, node );
+    else if( node->type == JSON_TYPE_STRING ) 
+    {
+      JSON_WriteCBORHead( writer, JSON_CBOR_TEXT, node->size );
+      if( node->value != NULL ) JSON_WriteData( writer, node->value, (size_t) node->size );
+    }
+    else
+    {
+      if( !JSON_LoadChildren( node ) && ( node->flags & JSON_CHILDREN_PENDING ) ) 
+      {
+        writer->error = JSON_ERROR_NO_SPACE;
+        break;
+      }
+      JSON_WriteCBORHead( writer, ( node->type == JSON_TYPE_BRACKET ) ? JSON_CBOR_ARRAY : JSON_CBOR_MAP, node->size );
+      if( node->size > 0 ) 
+      {
+        if( level >= stackSize ) 
+        {
+          JSONWriterFrame* newStack = (JSONWriterFrame*) JSON_AllocateHeap( 2 * stackSize * sizeof(JSONWriterFrame) );
+          if( newStack == NULL ) 
+          {
+            writer->error = JSON_ERROR_NO_SPACE;
+            break;
+          }
+          memcpy( newStack, containersStack, level * sizeof(JSONWriterFrame) );
+          if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONWriterFrame) );
+          containersStack = newStack;
+          stackSize *= 2;
+        }
+        containersStack[ level++ ] = (JSONWriterFrame) { .container = node, .childIndex = 0 };
+        node = node->childrenList[ 0 ];
+        continue;
+      }
+    }
+    // Move to next sibling, leaving finished containers
+    node = NULL;
+    while( level > 0 && node == NULL ) 
+    {
+      JSONWriterFrame* frame = &(containersStack[ level - 1 ]);
+      if( ++frame->childIndex < frame->container->size ) node = frame->container->childrenList[ frame->childIndex ];
+      else level--;
+    }
+  }
+  if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONWriterFrame) );
+  JSON_ADD_COUNTER( counters.serializeTime, JSON_GetTime() - startTime );
+}
+
+size_t JSON_EncodeCBOR( const JSONNode root, void* buffer, size_t capacity )
+{
+  if( root == NULL ) return 0;
+  JSONWriter writer = { .buffer = (char*) buffer, .capacity = ( buffer != NULL ) ? capacity : 0 };
+  JSON_WriteCBORNode( &writer, root );
+  return ( writer.error == JSON_OK ) ? writer.totalLength : 0;
+}
+
+// Read item head, skipping tags. Indefinite lengths and reserved encodings are not supported
+static bool JSON_ReadCBORHead( const unsigned char** ref_data, const unsigned char* end, unsigned char* ref_initialByte, unsigned long long* ref_argument )
+{
+  const unsigned char* data = *ref_data;
+  unsigned char initialByte;
+  unsigned long long argument;
+  do
+  {
+    if( data >= end ) return false;
+    initialByte = *(data++);
+    argument = initialByte & 0x1F;
+    if( argument >= 24 ) 
+    {
+      if( argument > 27 ) return false;
+      size_t argumentSize = (size_t) 1 << ( argument - 24 );
+      if( (size_t) ( end - data ) < argumentSize ) return false;
+      for( argument = 0; argumentSize > 0; argumentSize-- ) 
+        argument = ( argument << 8 ) | *(data++);
+    }
+  } while( ( initialByte >> 5 ) == JSON_CBOR_TAG );
+  *ref_data = data;
+  *ref_initialByte = initialByte;
+  *ref_argument = argument;
+  return true;
+}
+
+static double JSON_ReadCBORHalf( unsigned int bits )
+{
+  int exponent = (int) ( bits >> 10 ) & 0x1F;
+  double mantissa = (double) ( bits & 0x3FF );
+  double number;
+  if( exponent == 0 ) number = ldexp( mantissa, -24 );                  // Subnormal
+  else if( exponent < 31 ) number = ldexp( mantissa + 1024, exponent - 25 );
+  else number = ( mantissa == 0 ) ? INFINITY : NAN;
+  return ( bits & 0x8000 ) ? -number : number;
+}
+
+// Read text string item, returning its position inside given data
+static const char* JSON_ReadCBORText( const unsigned char** ref_data, const unsigned char* end, size_t* ref_length )
+{
+  unsigned char initialByte;
+  unsigned long long length;
+  if( !JSON_ReadCBORHead( ref_data, end, &initialByte, &length ) ) return NULL;
+  if( ( initialByte >> 5 ) != JSON_CBOR_TEXT || length > (unsigned long long) ( end - *ref_data ) || length > UINT_MAX ) return NULL;
+  const char* text = (const char*) *ref_data;
+  *ref_data += length;
+  *ref_length = (size_t) length;
+  return text;
+}
+
+// Read item value into given node. Containers get a children list allocated for the whole count, to be filled afterwards
+static bool JSON_ReadCBORValue( const unsigned char** ref_data, const unsigned char* end, JSONNode node )
+{
+  unsigned char initialByte;
+  unsigned long long argument;
+  const unsigned char* data = *ref_data;
+  if( !JSON_ReadCBORHead( &data, end, &initialByte, &argument ) ) return false;
+  int majorType = initialByte >> 5;
+  *ref_data = data;
+  if( majorType == JSON_CBOR_TEXT ) 
+  {
+    if( argument > (unsigned long long) ( end - data ) ) return false;
+    node->type = JSON_TYPE_STRING;
+    node->value = JSON_CopyString( NULL, (const char*) data, (size_t) argument );
+    if( node->value == NULL ) return false;
+    node->size = argument;
+    *ref_data = data + argument;
+    return true;
+  }
+  if( majorType == JSON_CBOR_ARRAY || majorType == JSON_CBOR_MAP ) 
+  {
+    // Every array element takes at least 1 byte, and every map entry 2, so that counts are bound by input size before allocation
+    size_t remainingLength = (size_t) ( end - data );
+    if( argument > ( ( majorType == JSON_CBOR_MAP ) ? remainingLength / 2 : remainingLength ) || argument > UINT_MAX ) return false;
+    node->type = ( majorType == JSON_CBOR_ARRAY ) ? JSON_TYPE_BRACKET : JSON_TYPE_BRACE;
+    if( argument > 0 ) 
+    {
+      node->childrenList = (JSONNode*) JSON_AllocateHeap( (size_t) argument * sizeof(JSONNode) );
+      if( node->childrenList == NULL ) return false;
+      node->capacity = (unsigned int) argument;
+    }
+    return true;
+  }
+  if( majorType == JSON_CBOR_UNSIGNED || majorType == JSON_CBOR_NEGATIVE ) 
+  {
+    node->type = JSON_TYPE_NUMBER;
+    if( argument > LLONG_MAX ) JSON_SetNumber( node, ( majorType == JSON_CBOR_UNSIGNED ) ? (double) argument : -1.0 - (double) argument );
+    else JSON_SetInteger( node, ( majorType == JSON_CBOR_UNSIGNED ) ? (long long) argument : -1 - (long long) argument );
+    return true;
+  }
+  if( majorType != JSON_CBOR_SIMPLE ) return false;             // Byte strings have no JSON counterpart
+  if( initialByte == JSON_CBOR_FALSE || initialByte == JSON_CBOR_TRUE ) 
+  {
+    node->type = JSON_TYPE_BOOLEAN;
+    JSON_Set( node, ( initialByte == JSON_CBOR_TRUE ) ? TRUE_STR : NULL );
+  }
+  else if( initialByte == JSON_CBOR_NULL || initialByte == JSON_CBOR_UNDEFINED ) 
+  {
+    JSON_Set( node, NULL );
+  }
+  else if( initialByte >= JSON_CBOR_HALF && initialByte <= JSON_CBOR_DOUBLE ) 
+  {
+    double number;
+    if( initialByte == JSON_CBOR_HALF ) number = JSON_ReadCBORHalf( (unsigned int) argument );
+    else if( initialByte == JSON_CBOR_FLOAT ) 
+    {
+      uint32_t bits = (uint32_t) argument;
+      float singleNumber;
+      memcpy( &singleNumber, &bits, sizeof(bits) );
+      number = singleNumber;
+    }
+    else memcpy( &number, &argument, sizeof(number) );
+    node->type = JSON_TYPE_NUMBER;
+    JSON_SetNumber( node, number );
+  }
+  else return false;
+  return true;
+}
+
+JSONNode JSON_DecodeCBOR( const void* data, size_t length )
+{
+  if( data == NULL ) return NULL;
+  unsigned long long startTime = JSON_GetTime();
+  const unsigned char* position = (const unsigned char*) data;
+  const unsigned char* end = position + length;
+  JSONNode localStack[ JSON_WRITER_STACK_SIZE ];
+  JSONNode* containersStack = localStack;                       // Containers with children left to read, innermost last
+  size_t stackSize = JSON_WRITER_STACK_SIZE, level = 0;
+  JSONNode root = NULL;
+  bool isValid = true;
+  do
+  {
+    // Nodes are linked to their parents as soon as created, so that the whole partial tree is released on errors
+    JSONNode parent = ( level > 0 ) ? containersStack[ level - 1 ] : NULL;
+    JSONNode node = JSON_CreateNode( NULL, JSON_TYPE_NULL );
+    if( node == NULL ) 
+    {
+      isValid = false;
+      break;
+    }
+    if( parent == NULL ) root = node;
+    else 
+    {
+      node->parent = parent;
+      parent->childrenList[ parent->size++ ] = node;
+    }
+    if( parent != NULL && parent->type == JSON_TYPE_BRACE ) 
+    {
+      size_t keyLength = 0;
+      const char* key = JSON_ReadCBORText( &position, end, &keyLength );
+      if( key != NULL ) JSON_SetChildKey( parent, node, parent->size - 1, key, keyLength );
+      isValid = ( node->key != NULL );
+    }
+    if( isValid ) isValid = JSON_ReadCBORValue( &position, end, node );
+    if( !isValid ) break;
+    if( JSON_IS_INTERNAL( node ) && node->capacity > 0 ) 
+    {
+      if( level >= stackSize ) 
+      {
+        JSONNode* newStack = (JSONNode*) JSON_AllocateHeap( 2 * stackSize * sizeof(JSONNode) );
+        if( newStack == NULL ) 
+        {
+          isValid = false;
+          break;
+        }
+        memcpy( newStack, containersStack, level * sizeof(JSONNode) );
+        if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONNode) );
+        containersStack = newStack;
+        stackSize *= 2;
+      }
+      containersStack[ level++ ] = node;
+    }
+    while( level > 0 && containersStack[ level - 1 ]->size == containersStack[ level - 1 ]->capacity ) 
+      JSON_PrepareKeyIndex( NULL, containersStack[ --level ] );
+  } while( level > 0 );
+  if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONNode) );
+  if( !isValid || position != end ) 
+  {
+    JSON_Destroy( root );
+    root = NULL;
+  }
+  JSON_ADD_COUNTER( counters.parseTime, JSON_GetTime() - startTime );
+  return root;
+}
+
+// Resolve deferred state of given node (text of numbers, unterminated slices, unread children, key index), 
+// so that reading it doesn't write to memory anymore. False if there is no memory for it
+static bool JSON_ResolveNode( JSONNode node )
+{
+  node->cachedOutputs = 0;
+  if( JSON_IS_INTERNAL( node ) ) 
+  {
+    if( !JSON_LoadChildren( node ) && ( node->flags & JSON_CHILDREN_PENDING ) ) return false;
+    JSON_PrepareKeyIndex( NULL, node );               // Retried for indexes that had no memory before. Frozen nodes without index are searched linearly
+    return true;
+  }
+  if( node->type == JSON_TYPE_NUMBER && node->value != NULL && !( node->flags & JSON_NUMBER_CACHED ) ) 
+  {
+    JSON_CacheNumber( node, true );
+    if( !( node->flags & JSON_NUMBER_CACHED ) ) return false;
+  }
+  JSON_Get( node );
+  return !( node->flags & ( JSON_TEXT_STALE | JSON_VALUE_SLICE ) );
+}
+
+// References count takes the place of the parent pointer, as frozen nodes may be shared by any number of containers
+static inline void JSON_FreezeNode( JSONNode node )
+{
+  node->flags |= JSON_FROZEN;
+  node->referencesCount = 1;                          // Owned by its parent, or by the caller for the root
+}
+
+JSONNode JSON_Freeze( JSONNode root )
+{
+  if( root == NULL || ( root->flags & JSON_FROZEN ) ) return root;
+  if( !JSON_ResolveNode( root ) ) return NULL;
+  // Depth first traversal with explicit stack, freezing containers after their children. Frozen subtrees (shared from other snapshots) are skipped
+  JSONWriterFrame localStack[ JSON_WRITER_STACK_SIZE ];
+  JSONWriterFrame* containersStack = localStack;
+  size_t stackSize = JSON_WRITER_STACK_SIZE, level = 0;
+  bool isValid = true;
+  JSONNode node = root;
+  while( node != NULL ) 
+  {
+    if( JSON_IS_INTERNAL( node ) && node->size > 0 ) 
+    {
+      if( level >= stackSize ) 
+      {
+        JSONWriterFrame* newStack = (JSONWriterFrame*) JSON_AllocateHeap( 2 * stackSize * sizeof(JSONWriterFrame) );
+        if( newStack == NULL ) 
+        {
+          isValid = false;
+          break;
+        }
+        memcpy( newStack, containersStack, level * sizeof(JSONWriterFrame) );
+        if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONWriterFrame) );
+        containersStack = newStack;
+        stackSize *= 2;
+      }
+      containersStack[ level++ ] = (JSONWriterFrame) { .container = node, .childIndex = 0 };
+    }
+    else JSON_FreezeNode( node );
+    // Move to next modifiable child, freezing finished containers
+    node = NULL;
+    while( level > 0 && node == NULL ) 
+    {
+      JSONWriterFrame* frame = &(containersStack[ level - 1 ]);
+      if( frame->childIndex < frame->container->size ) 
+      {
+        JSONNode child = frame->container->childrenList[ frame->childIndex++ ];
+        if( !( child->flags & JSON_FROZEN ) ) node = child;
+      }
+      else JSON_FreezeNode( containersStack[ --level ].container );
+    }
+    if( node != NULL && !JSON_ResolveNode( node ) ) 
+    {
+      isValid = false;
+      break;
+    }
+  }
+  if( containersStack != localStack ) JSON_FreeHeap( containersStack, stackSize * sizeof(JSONWriterFrame) );
+  // Subtrees frozen before a failure are shared by the still modifiable tree, as after thawing
+  return isValid ? root : NULL;
+}
+
+// Modifiable copy of frozen node, sharing its children (each with one more reference)
+static JSONNode JSON_CopyFrozen( const JSONNode root )
+{
+  JSONNode newNode = JSON_CreateNode( NULL, (enum JSONNodeType) root->type );
+  if( newNode == NULL ) return NULL;
+  if( root->key != NULL ) 
+  {
+    if( ( root->flags & ( JSON_KEY_SHARED | JSON_KEY_EXTERNAL ) ) == JSON_KEY_SHARED ) newNode->key = JSON_RetainKey( root->key );
+    else newNode->key = JSON_CreateKey( NULL, root->key, root->keyLength, JSON_HashKey( root->key, root->keyLength ) );
+    if( newNode->key == NULL ) 
+    {
+      JSON_Destroy( newNode );
+      return NULL;
+    }
+    newNode->keyLength = root->keyLength;
+    newNode->flags |= JSON_KEY_SHARED;
+  }
+  if( JSON_IS_INTERNAL( root ) ) 
+  {
+    if( root->size > 0 ) 
+    {
+      newNode->childrenList = (JSONNode*) JSON_AllocateHeap( (size_t) root->size * sizeof(JSONNode) );
+      if( newNode->childrenList == NULL ) 
+      {
+        JSON_Destroy( newNode );
+        return NULL;
+      }
+      memcpy( newNode->childrenList, root->childrenList, (size_t) root->size * sizeof(JSONNode) );
+      newNode->size = newNode->capacity = root->size;
+      for( size_t childIndex = 0; childIndex < newNode->size; childIndex++ )
+        JSON_ADD_SHARED( newNode->childrenList[ childIndex ]->referencesCount, 1 );
+      JSON_PrepareKeyIndex( NULL, newNode );
+    }
+  }
+  else if( root->type == JSON_TYPE_NULL || root->type == JSON_TYPE_BOOLEAN ) 
+  {
+    JSON_Set( newNode, ( root->value == TRUE_STR ) ? TRUE_STR : NULL );
+  }
+  else
+  {
+    if( root->value != NULL ) 
+    {
+      newNode->value = JSON_CopyString( NULL, root->value, (size_t) root->size );
+      if( newNode->value == NULL ) 
+      {
+        JSON_Destroy( newNode );
+        return NULL;
+      }
+      newNode->size = root->size;
+    }
+    newNode->flags |= root->flags & ( JSON_NUMBER_CACHED | JSON_NUMBER_INTEGER );
+    newNode->integer = root->integer;
+  }
+  return newNode;
+}
+
+JSONNode JSON_Thaw( JSONNode root )
+{
+  if( root == NULL || !( root->flags & JSON_FROZEN ) ) return root;
+  return JSON_CopyFrozen( root );
+}
+
+// Replace frozen child of modifiable container by a modifiable copy (path copying)
+static JSONNode JSON_ThawChild( JSONNode root, long position )
+{
+  JSONNode child = root->childrenList[ position ];
+  if( !( child->flags & JSON_FROZEN ) ) return child;
+  JSONNode newChild = JSON_CopyFrozen( child );
+  if( newChild == NULL ) return NULL;
+  newChild->parent = root;
+  root->childrenList[ position ] = newChild;
+  JSON_InvalidateOutput( root );
+  JSON_Destroy( child );                              // Drop the reference of the container
+  return newChild;
+}
+
+JSONNode JSON_ThawByKey( JSONNode root, const char* key )
+{
+  if( root == NULL || root->type != JSON_TYPE_BRACE || ( root->flags & JSON_FROZEN ) || !JSON_LoadChildren( root ) ) return NULL;
+  size_t keyLength = strlen( key );
+  long position = JSON_FindChildPosition( root, key, keyLength, JSON_HashKey( key, keyLength ) );
+  return ( position >= 0 ) ? JSON_ThawChild( root, position ) : NULL;
+}
+
+JSONNode JSON_ThawByIndex( JSONNode root, long index )
+{
+  if( root == NULL || !JSON_IS_INTERNAL( root ) || ( root->flags & JSON_FROZEN ) || !JSON_LoadChildren( root ) ) return NULL;
+  return ( 0 <= index && index < (long) root->size ) ? JSON_ThawChild( root, index ) : NULL;
+}
+
+// Readers count themselves in the counter of current epoch only while taking a reference to the published snapshot. 
+// Publications switch epochs and wait for the previous counter to drain (grace period) before releasing the replaced snapshot
+struct _JSONPublisherData
+{
+  JSONNode snapshot;                                  // Frozen tree handed to readers
+  unsigned long epoch;                                // Number of publications. Its parity selects the counter of new readers
+  unsigned long readersCount[ 2 ];
+};
+
+static inline void JSON_Yield( void )
+{
+#ifdef JSON_USE_POSIX
+  sched_yield();
+#endif
+}
+
+JSONPublisher JSON_CreatePublisher( void )
+{
+  JSONPublisher newPublisher = (JSONPublisher) JSON_AllocateHeap( sizeof(JSONPublisherData) );
+  if( newPublisher == NULL ) return NULL;
+  memset( newPublisher, 0, sizeof(JSONPublisherData) );
+  return newPublisher;
+}
+
+int JSON_Publish( JSONPublisher publisher, JSONNode snapshot )
+{
+  if( publisher == NULL ) return JSON_ERROR_NO_VALUE;
+  if( snapshot != NULL && !( snapshot->flags & JSON_FROZEN ) ) return JSON_ERROR_UNEXPECTED;
+  JSONNode oldSnapshot = JSON_LOAD_SHARED( publisher->snapshot );
+  JSON_STORE_SHARED( publisher->snapshot, snapshot );
+  unsigned long oldEpoch = JSON_ADD_SHARED( publisher->epoch, 1 ) - 1;
+  while( JSON_LOAD_SHARED( publisher->readersCount[ oldEpoch & 1 ] ) > 0 ) JSON_Yield();
+  JSON_Destroy( oldSnapshot );
+  return JSON_OK;
+}
+
+JSONNode JSON_Acquire( JSONPublisher publisher )
+{
+  if( publisher == NULL ) return NULL;
+  unsigned long* readersCount;
+  while( true )                                       // Retry if a publication switched epochs before the reader was counted
+  {
+    unsigned long epoch = JSON_LOAD_SHARED( publisher->epoch );
+    readersCount = &(publisher->readersCount[ epoch & 1 ]);
+    JSON_ADD_SHARED( *readersCount, 1 );
+    if( JSON_LOAD_SHARED( publisher->epoch ) == epoch ) break;
+    JSON_ADD_SHARED( *readersCount, (unsigned long) -1 );
+  }
+  JSONNode snapshot = JSON_LOAD_SHARED( publisher->snapshot );
+  if( snapshot != NULL ) JSON_ADD_SHARED( snapshot->referencesCount, 1 );
+  JSON_ADD_SHARED( *readersCount, (unsigned long) -1 );
+  return snapshot;
+}
+
+void JSON_DestroyPublisher( JSONPublisher publisher )
+{
+  if( publisher == NULL ) return;
+  JSON_Destroy( publisher->snapshot );
+  JSON_FreeHeap( publisher, sizeof(JSONPublisherData) );
 }
@@ -60,6 +60,8 @@
 #define JSON_H
 
 #include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
 
 enum JSONNodeType { JSON_TYPE_NULL, JSON_TYPE_BOOLEAN, JSON_TYPE_NUMBER, JSON_TYPE_STRING, JSON_TYPE_BRACKET, JSON_TYPE_BRACE };
 
@@ -67,6 +69,10 @@ enum JSONNodeType { JSON_TYPE_NULL, JSON_TYPE_BOOLEAN, JSON_TYPE_NUMBER, JSON_TY
 #define JSON_ERROR_UNEXPECTED  1
 #define JSON_ERROR_NO_KEY      2
 #define JSON_ERROR_NO_VALUE    3
+#define JSON_ERROR_NO_SPACE    4
+#define JSON_ERROR_OUTPUT      5
+#define JSON_ERROR_INVALID_NUMBER  6
+#define JSON_ERROR_TOO_DEEP        7
 
 #define JSON_FORMAT_SERIAL   -1
 #define JSON_FORMAT_IDENT    0
@@ -77,21 +83,298 @@ typedef struct _JSONNodeData JSONNodeData;
 /// Opaque reference to JSON node tree data structure/object
 typedef JSONNodeData* JSONNode;
 
+/// Compiled path internal data structure/object
+typedef struct _JSONPathData JSONPathData;
+/// Opaque reference to pre-parsed sequence of keys and/or indexes, for repeated lookups
+typedef JSONPathData* JSONPath;
+
+/// Memory arena internal data structure/object
+typedef struct _JSONArenaData JSONArenaData;
+/// Opaque reference to memory arena from which whole JSON trees can be allocated and released at once
+typedef JSONArenaData* JSONArena;
+
+/// Tape document internal data structure/object
+typedef struct _JSONTapeData JSONTapeData;
+/// Opaque reference to read-only document stored as a flat sequence of tagged entries, with items referenced by position
+typedef JSONTapeData* JSONTape;
+
+/// Output cache internal data structure/object
+typedef struct _JSONCacheData JSONCacheData;
+/// Opaque reference to last serialization of a tree, kept for incremental rewriting
+typedef JSONCacheData* JSONCache;
+
+/// Snapshot publisher internal data structure/object
+typedef struct _JSONPublisherData JSONPublisherData;
+/// Opaque reference to shared slot through which frozen trees are handed from a writer to concurrent readers
+typedef JSONPublisherData* JSONPublisher;
+
+#define JSON_TAPE_ROOT    1                 ///< position of the top level item of any tape
+#define JSON_TAPE_NONE    ( (size_t) -1 )   ///< position returned when an item is not found
+
+/// Streaming parser internal data structure/object
+typedef struct _JSONStreamData JSONStreamData;
+/// Opaque reference to incremental (push) parser, which reports JSON elements through callbacks instead of building a tree
+typedef JSONStreamData* JSONStream;
+
+/// Functions called by streaming parser as JSON elements are read. Any of them may be NULL
+typedef struct _JSONStreamCallbacks
+{
+  void* userData;                                                                     ///< reference passed back to every callback
+  void (*startObject)( void* userData );                                              ///< called on JSON_TYPE_BRACE node start
+  void (*endObject)( void* userData );                                                ///< called on JSON_TYPE_BRACE node end
+  void (*startArray)( void* userData );                                               ///< called on JSON_TYPE_BRACKET node start
+  void (*endArray)( void* userData );                                                 ///< called on JSON_TYPE_BRACKET node end
+  void (*key)( void* userData, const char* key, size_t length );                      ///< called before the value of an object member
+  void (*scalar)( void* userData, enum JSONNodeType type, const char* value, size_t length ); ///< called for each non container value
+}
+JSONStreamCallbacks;
+
+/// Parsing settings for JSON_ParseEx
+typedef struct _JSONParseOptions
+{
+  size_t maxDepth;                ///< maximum nesting level of BRACKET/BRACE nodes. 0 for no limit
+}
+JSONParseOptions;
+
+/// Parsing result details for JSON_ParseEx
+typedef struct _JSONErrorInfo
+{
+  int code;                       ///< JSON_OK, or JSON_ERROR_* code of the failure
+  size_t offset;                  ///< position (in bytes) where parsing failed, or stopped on success
+}
+JSONErrorInfo;
+
+/// Function called for each record (line) parsed by JSON_ParseLines
+/// @param userData reference passed to JSON_ParseLines
+/// @param offset position (in bytes) of the record line in parsed buffer
+/// @param root root node of the record tree, valid only during the call. NULL on errors
+/// @param error JSON_OK, or JSON_ERROR_* code of the record parsing failure
+typedef void (*JSONLineCallback)( void* userData, size_t offset, JSONNode root, int error );
+
+/// Library wide memory and timing counters, returned by JSON_GetStats
+typedef struct _JSONStats
+{
+  size_t liveNodes;               ///< number of heap allocated nodes not yet destroyed (arena nodes are not counted)
+  size_t liveBytes;               ///< heap memory (in bytes) currently held by the library, including arena blocks
+  size_t peakBytes;               ///< maximum value reached by liveBytes
+  size_t allocationsCount;        ///< number of memory allocations requested
+  size_t reallocationsCount;      ///< number of memory reallocations requested
+  double parseTime;               ///< cumulative time (in seconds) spent parsing
+  double serializeTime;           ///< cumulative time (in seconds) spent writing trees
+}
+JSONStats;
+
+/// Types of C structure fields read/written directly by JSON_DecodeStruct and JSON_EncodeStruct
+enum JSONFieldType 
+{ 
+  JSON_FIELD_DOUBLE,              ///< float or double (by field size), from/to JSON number
+  JSON_FIELD_INT,                 ///< signed integer of 1, 2, 4 or 8 bytes (by field size), from/to JSON integer number
+  JSON_FIELD_BOOL,                ///< bool, from/to JSON true/false
+  JSON_FIELD_STRING,              ///< fixed size char array, from/to JSON string (escape sequences are kept as is)
+  JSON_FIELD_STRUCT               ///< nested structure, from/to JSON object
+};
+
+/// Entry of static descriptor table mapping JSON object keys to C structure fields. Tables end with an entry with NULL key
+typedef struct _JSONField
+{
+  const char* key;                ///< key of object member. NULL for end of table
+  enum JSONFieldType type;        ///< type of field, or of its elements for arrays
+  size_t offset;                  ///< position of field in structure (offsetof)
+  size_t size;                    ///< size of field, or of each element for arrays (sizeof). For strings, includes null terminator
+  const struct _JSONField* fields;  ///< descriptor table of nested structure (JSON_FIELD_STRUCT only)
+  size_t maxCount;                ///< number of elements of fixed size array field, from/to JSON array. 0 for single values
+  size_t countOffset;             ///< position of size_t field holding number of used array elements (arrays only)
+}
+JSONField;
+
+/// @brief Replace functions used by the library for heap memory. Must be called before any other library call
+/// @param allocate function returning a block of given size, or NULL on failure
+/// @param reallocate function resizing given block (never NULL), returning its new location or NULL on failure
+/// @param release function releasing given block (never NULL)
+/// @param context reference passed back to each function call
+/// @note passing NULL for any function restores the default ones (malloc, realloc and free)
+void JSON_SetAllocator( void* (*allocate)( void* context, size_t size ), void* (*reallocate)( void* context, void* pointer, size_t size ),
+                        void (*release)( void* context, void* pointer ), void* context );
+
+/// @brief Get memory and timing counters accumulated since program start, updated atomically from all threads
+/// @return copy of current counters values
+JSONStats JSON_GetStats( void );
+
 /// @brief Generate JSON tree data structure from a serialized JSON string
 /// @param jsonString serialized JSON string
 /// @return reference/pointer to root node of generated JSON tree data structure
 JSONNode JSON_Parse( const char* jsonString );
 
+/// @brief Generate JSON tree data structure from a serialized JSON buffer of known length
+/// @param jsonData serialized JSON data. Does not need to be null terminated, and is never read past given length
+/// @param length number of bytes of serialized JSON data
+/// @return reference/pointer to root node of generated JSON tree data structure. NULL on errors
+JSONNode JSON_ParseN( const char* jsonData, size_t length );
+
+/// @brief Generate JSON tree data structure from the contents of a file, memory mapped when possible
+/// @param filePath path to file containing serialized JSON data
+/// @return reference/pointer to root node of generated JSON tree data structure. NULL on errors
+JSONNode JSON_ParseFile( const char* filePath );
+
+/// @brief Generate JSON tree data structure from serialized JSON data, with settings and error details
+/// @param jsonData serialized JSON data (doesn't need to be null terminated)
+/// @param length size (in bytes) of data to be parsed
+/// @param options parsing settings. NULL for defaults (no depth limit)
+/// @param ref_errorInfo pointer to structure filled with result code (JSON_ERROR_TOO_DEEP if maxDepth is exceeded) and position. May be NULL
+/// @return reference/pointer to root node of generated JSON tree data structure. NULL on errors
+JSONNode JSON_ParseEx( const char* jsonData, size_t length, const JSONParseOptions* options, JSONErrorInfo* ref_errorInfo );
+
+/// @brief Parse newline delimited JSON records in parallel, each worker thread taking chunks of whole lines and allocating from its own arena
+/// @param buffer serialized JSON data, with one record per line (blank lines are ignored)
+/// @param length size (in bytes) of data to be parsed
+/// @param threadsCount number of threads used for parsing (including the calling one). 0 for number of available processors
+/// @param isOrdered true to call callback for each record in input order, one call at a time. false to call it from worker threads as soon as records are parsed, possibly concurrently
+/// @param callback function called for each parsed record
+/// @param userData reference passed back to callback
+/// @return JSON_OK if all records were parsed, JSON_ERROR_* code of the first failed record otherwise
+int JSON_ParseLines( const char* buffer, size_t length, int threadsCount, bool isOrdered, JSONLineCallback callback, void* userData );
+
+/// @brief Generate JSON tree data structure referencing keys and values inside the given string, instead of copying them
+/// @param jsonString serialized JSON string. Not modified, and must outlive the generated tree
+/// @return reference/pointer to root node of generated JSON tree data structure
+JSONNode JSON_ParseView( const char* jsonString );
+
+/// @brief Generate JSON tree data structure referencing keys and values inside the given string, terminating them in place
+/// @param jsonString serialized JSON string. Modified by value accesses, and must outlive the generated tree
+/// @return reference/pointer to root node of generated JSON tree data structure
+JSONNode JSON_ParseInSitu( char* jsonString );
+
+/// @brief Generate JSON tree data structure reading only the top level container, and the children of nested ones on first access
+/// @param jsonString serialized JSON string. Not modified, and must outlive the generated tree
+/// @return reference/pointer to root node of generated JSON tree data structure. NULL on errors
+/// @note Nested containers are loaded by lookups, children count queries, additions and idented writes, so that even reading the tree is not thread safe. 
+/// Unread containers are written back verbatim in serialized mode. Their content is validated up front, so that the same documents as in JSON_Parse are rejected
+JSONNode JSON_ParseLazy( const char* jsonString );
+
+/// @brief Create memory arena for allocation of parsed JSON trees
+/// @param blockSize size (in bytes) of each memory block reserved by the arena. 0 for default size
+/// @return reference/pointer to created arena. NULL on errors
+JSONArena JSON_CreateArena( size_t blockSize );
+
+/// @brief Generate JSON tree data structure from a serialized JSON string, taking all its memory from given arena
+/// @param arena memory arena where nodes, keys, values and children lists will be allocated
+/// @param jsonString serialized JSON string
+/// @return reference/pointer to root node of generated JSON tree data structure. Released only with the arena
+/// @note Equal keys of all documents parsed into the same arena (since its last reset) share a single copy. Keys of nodes added afterwards are copied to the heap
+JSONNode JSON_ParseInArena( JSONArena arena, const char* jsonString );
+
+/// @brief Release at once all JSON trees allocated from given arena, keeping its memory for reuse
+/// @param arena memory arena to be reset. Nodes later added to its trees must be destroyed before
+void JSON_ResetArena( JSONArena arena );
+
+/// @brief Destroy given memory arena, releasing all JSON trees allocated from it
+/// @param arena memory arena to be destroyed
+void JSON_DestroyArena( JSONArena arena );
+
+/// @brief Create incremental parser that reads a JSON document as it arrives, using memory proportional to its nesting depth
+/// @param callbacks functions called for each element read (copied)
+/// @return reference/pointer to created streaming parser. NULL on errors
+JSONStream JSON_CreateStream( const JSONStreamCallbacks* callbacks );
+
+/// @brief Parse next chunk of JSON document, calling callbacks for elements completed in it
+/// @param stream streaming parser reference
+/// @param data chunk of serialized JSON data. Tokens may be split across chunks, and data is not referenced after return
+/// @param length number of bytes in given chunk
+/// @return JSON_OK, or JSON_ERROR_* code if the document is malformed
+int JSON_FeedStream( JSONStream stream, const char* data, size_t length );
+
+/// @brief Signal end of JSON document, reporting any pending element and resetting parser for the next document
+/// @param stream streaming parser reference
+/// @return JSON_OK, or JSON_ERROR_* code if the document is incomplete or malformed
+int JSON_FinishStream( JSONStream stream );
+
+/// @brief Destroy streaming parser
+/// @param stream streaming parser reference
+void JSON_DestroyStream( JSONStream stream );
+
+/// @brief Generate read-only tape document from serialized JSON data, without creating any node
+/// @param jsonData serialized JSON data (doesn't need to be null terminated). Accepted documents are the same as in JSON_Parse
+/// @param length size (in bytes) of data to be parsed
+/// @return reference/pointer to tape document. NULL on errors
+JSONTape JSON_ParseTape( const char* jsonData, size_t length );
+
+/// @brief Destroy tape document, invalidating strings returned from it
+/// @param tape tape document reference
+void JSON_DestroyTape( JSONTape tape );
+
+/// @brief Get type of tape item
+/// @param tape tape document reference
+/// @param item position of the item (JSON_TAPE_ROOT for top level one)
+/// @return type of the item (JSON_TYPE_NULL for invalid positions)
+enum JSONNodeType JSON_GetTapeType( JSONTape tape, size_t item );
+/// @brief Get value string of tape item
+/// @param tape tape document reference
+/// @param item position of the item
+/// @return pointer to value string (NULL for containers or invalid positions)
+const char* JSON_GetTapeValue( JSONTape tape, size_t item );
+/// @brief Get length of the value string of tape item
+/// @param tape tape document reference
+/// @param item position of the item
+/// @return length (in bytes) of the value string (0 for containers or invalid positions)
+size_t JSON_GetTapeLength( JSONTape tape, size_t item );
+/// @brief Get key string of tape item
+/// @param tape tape document reference
+/// @param item position of the item
+/// @return pointer to key string (NULL for items outside objects)
+const char* JSON_GetTapeKey( JSONTape tape, size_t item );
+/// @brief Get number of children of tape item
+/// @param tape tape document reference
+/// @param item position of the item
+/// @return number of children (0 for non container items)
+unsigned long JSON_GetTapeChildrenCount( JSONTape tape, size_t item );
+/// @brief Get item following given one inside the same container, skipping its whole subtree
+/// @param tape tape document reference
+/// @param item position of the item
+/// @return position of the next item. JSON_TAPE_NONE if given item is the last one
+size_t JSON_GetTapeNext( JSONTape tape, size_t item );
+/// @brief Find child of object tape item with given key
+/// @param tape tape document reference
+/// @param item position of the object item
+/// @param key key string of the searched child
+/// @return position of the first child found. JSON_TAPE_NONE if nothing is found
+size_t JSON_FindTapeKey( JSONTape tape, size_t item, const char* key );
+/// @brief Find child of container tape item at given index
+/// @param tape tape document reference
+/// @param item position of the container item
+/// @param index index of the searched child
+/// @return position of the child found. JSON_TAPE_NONE if nothing is found
+size_t JSON_FindTapeIndex( JSONTape tape, size_t item, long index );
+/// @brief Create mutable JSON tree from tape item and its children
+/// @param tape tape document reference
+/// @param item position of the item
+/// @return reference/pointer to root node of created tree, independent from the tape. NULL for invalid positions
+JSONNode JSON_MaterializeTape( JSONTape tape, size_t item );
+
 /// @brief Create root/base JSON node of given type
 /// @param type enum value defining node type (JSON_TYPE_{NULL,BOOLEAN,NUMBER,STRING,BRACKET,BRACE})
 /// @param key string key to index the node. NULL for node without key
 /// @return reference/pointer to created node. NULL on errors
 JSONNode JSON_Create( enum JSONNodeType type, const char* key );
 
+/// @brief Reserve space in the children list of given JSON node, so that children can be added up to given count without reallocation
+/// @param root BRACKET/BRACE node to be extended
+/// @param capacity total number of children the node should be able to hold
+/// @return JSON_OK on success, JSON_ERROR_NO_SPACE if memory could not be allocated, JSON_ERROR_UNEXPECTED for non container nodes
+int JSON_Reserve( JSONNode root, size_t capacity );
+
+/// @brief Release unused space of the children list of given JSON node
+/// @param root BRACKET/BRACE node to be compacted
+void JSON_ShrinkToFit( JSONNode root );
+
 enum JSONNodeType JSON_GetType( JSONNode root );
 
 const char* JSON_Get( JSONNode root );
 
+/// @brief Get length of the value string of given JSON node, without scanning it
+/// @param root node from which the value length is read
+/// @return number of characters of node value. 0 for BRACKET/BRACE nodes
+size_t JSON_GetLength( JSONNode root );
+
 unsigned long JSON_GetChildrenCount( JSONNode root );
 
 /// @brief Set value of given JSON node
@@ -99,13 +382,85 @@ unsigned long JSON_GetChildrenCount( JSONNode root );
 /// @param value node value in string form
 void JSON_Set( JSONNode root, const char* value );
     
+/// @brief Get value of JSON_TYPE_NUMBER node in binary form (reads don't write to the node: text not converted at parse time is converted on each call)
+/// @param root node from which the value is read
+/// @return node numeric value. 0 for other node types
+double JSON_GetNumber( JSONNode root );
+
+/// @brief Get value of JSON_TYPE_NUMBER node as integer (converted like in JSON_GetNumber)
+/// @param root node from which the value is read
+/// @return node numeric value, truncated if not integer. 0 for other node types
+long long JSON_GetInteger( JSONNode root );
+
+/// @brief Get value of JSON_TYPE_BOOLEAN node
+/// @param root node from which the value is read
+/// @return node boolean value. false for other node types
+bool JSON_GetBoolean( JSONNode root );
+
+/// @brief Set value of JSON_TYPE_NUMBER node in binary form. Text is generated only when needed
+/// @param root node for which the value will be set
+/// @param value node numeric value. NaN and infinite values (not representable in JSON) turn the node into JSON_TYPE_NULL
+void JSON_SetNumber( JSONNode root, double value );
+
+/// @brief Set value of JSON_TYPE_NUMBER node as integer. Text is generated only when needed
+/// @param root node for which the value will be set
+/// @param value node numeric value
+void JSON_SetInteger( JSONNode root, long long value );
+
+/// @brief Set value of JSON_TYPE_BOOLEAN node
+/// @param root node for which the value will be set
+/// @param value node boolean value
+void JSON_SetBoolean( JSONNode root, bool value );
+
 /// @brief Clear value of given node or destroy its children, if internal
 /// @param root node from which the clearing starts
 void JSON_Clear( JSONNode root );
     
 /// @brief Destroy given node and its children, if any
-/// @param root node to be destroyed
+/// @param root node to be destroyed. For frozen nodes, one reference is released, and the tree is destroyed along with the last one
 void JSON_Destroy( JSONNode root );
+
+/// @brief Make given tree immutable, so that it can be read from any number of threads without locking, and shared by other trees
+/// @param root root/base node of the tree to be frozen. Deferred work (number conversions, lazy children, key indexes) is done beforehand
+/// @return given root, owning a single reference (released with JSON_Destroy). Modifying functions have no effect on frozen nodes. 
+/// NULL if there is no memory for deferred work, leaving the tree modifiable (and owned by the caller)
+JSONNode JSON_Freeze( JSONNode root );
+
+/// @brief Get modifiable copy of frozen node, for building the next version of a tree with structural sharing
+/// @param root frozen node to be copied. The caller must hold a reference to its tree
+/// @return reference/pointer to new node, sharing the (still frozen) children of the copied one. Given node itself, if not frozen
+JSONNode JSON_Thaw( JSONNode root );
+
+/// @brief Replace frozen child of modifiable BRACE node by a modifiable copy, as in JSON_Thaw
+/// @param root modifiable BRACE node where the child is searched
+/// @param key key of the child to be thawed
+/// @return reference/pointer to modifiable child node. NULL if nothing is found
+JSONNode JSON_ThawByKey( JSONNode root, const char* key );
+
+/// @brief Replace frozen child of modifiable BRACKET/BRACE node by a modifiable copy, as in JSON_Thaw
+/// @param root modifiable BRACKET/BRACE node where the child is searched
+/// @param index position of the child to be thawed
+/// @return reference/pointer to modifiable child node. NULL if nothing is found
+JSONNode JSON_ThawByIndex( JSONNode root, long index );
+
+/// @brief Create slot for publishing frozen trees to concurrent readers
+/// @return reference/pointer to created publisher, initially without snapshot. NULL on errors
+JSONPublisher JSON_CreatePublisher( void );
+
+/// @brief Replace published snapshot. Waits only for readers in the middle of JSON_Acquire, before releasing the replaced snapshot
+/// @param publisher publisher reference. Publications on the same publisher must not overlap
+/// @param snapshot frozen tree, whose reference is taken by the publisher. May be NULL
+/// @return JSON_OK on success, JSON_ERROR_UNEXPECTED for trees that are not frozen
+int JSON_Publish( JSONPublisher publisher, JSONNode snapshot );
+
+/// @brief Get currently published snapshot, without locking
+/// @param publisher publisher reference
+/// @return frozen tree, with a reference owned by the caller (released with JSON_Destroy). NULL if nothing was published
+JSONNode JSON_Acquire( JSONPublisher publisher );
+
+/// @brief Destroy publisher, releasing its reference to the published snapshot
+/// @param publisher publisher reference. No reader may be acquiring from it anymore
+void JSON_DestroyPublisher( JSONPublisher publisher );
     
 /// @brief Find node (inside a BRACE type node) by its key
 /// @param root pointer to the node (BRACE type) where search will be performed
@@ -125,6 +480,38 @@ JSONNode JSON_FindByIndex( const JSONNode root, long index );
 /// @return reference/pointer to found node. NULL if nothing is found
 JSONNode JSON_FindByPath( const JSONNode root, int pathArgsCount, ... );
     
+/// @brief Pre-parse path string for fast repeated lookups
+/// @param pathString keys separated by '.' and/or indexes between brackets (e.g. "robot.joints[3].position"). Keys containing separators may be quoted inside brackets (e.g. "[\"a.b\"]")
+/// @return reference/pointer to compiled path. NULL for malformed paths
+JSONPath JSON_CompilePath( const char* pathString );
+
+/// @brief Find node following a compiled path
+/// @param root pointer to the node from where search will be performed
+/// @param path compiled path. Caches the positions where keys were found, so it should not be shared between threads
+/// @return reference/pointer to found node. NULL if nothing is found
+JSONNode JSON_Resolve( const JSONNode root, JSONPath path );
+
+/// @brief Destroy compiled path
+/// @param path compiled path reference
+void JSON_DestroyPath( JSONPath path );
+
+/// @brief Create cache for repeated serialization of the same tree, where only modified containers are written again
+/// @param mode format of the string representation. Serialized (JSON_FMT_SERIAL) or idented (JSON_FMT_IDENT)
+/// @return reference/pointer to created cache. NULL on errors
+JSONCache JSON_CreateCache( int mode );
+
+/// @brief Write JSON data tree to cache buffer, copying unchanged containers from the previous output of the same tree
+/// @param cache output cache reference. Several caches may write the same tree, each one reusing its own last output. 
+/// Only 8 caches reuse their outputs at the same time: others write the whole tree each time
+/// @param root root/base node of the tree to be written
+/// @param ref_length pointer to variable receiving the output length (without terminator). May be NULL
+/// @return reference/pointer to null terminated output, owned by the cache and valid until its next write. NULL on errors
+const char* JSON_WriteCached( JSONCache cache, const JSONNode root, size_t* ref_length );
+
+/// @brief Destroy output cache and its buffers
+/// @param cache output cache reference
+void JSON_DestroyCache( JSONCache cache );
+
 /// @brief Display JSON data tree as a formatted string
 /// @param root root/base node of the tree to be displayed
 void JSON_Print( const JSONNode root );
@@ -132,9 +519,61 @@ void JSON_Print( const JSONNode root );
 /// @brief Write JSON data tree to a string
 /// @param root root/base node of the tree to be written
 /// @param mode format of the string representation. Serialized (JSON_FMT_SERIAL) or idented (JSON_FMT_IDENT)
-/// @return reference/pointer to allocated string containing JSON data. Must be freed manually
+/// @return reference/pointer to allocated string containing JSON data. Must be freed manually, with free() or the release function given to JSON_SetAllocator
 char* JSON_GetString( const JSONNode root, int mode );
     
+/// @brief Write JSON data tree to a caller provided buffer, in a single pass
+/// @param root root/base node of the tree to be written
+/// @param mode format of the string representation. Serialized (JSON_FMT_SERIAL) or idented (JSON_FMT_IDENT)
+/// @param buffer destination of the (always null terminated) JSON string
+/// @param capacity size (in bytes) of destination buffer
+/// @param ref_neededSize pointer to variable where the buffer size required for the whole string (including terminator) is stored. May be NULL
+/// @return JSON_OK if the whole string was written, JSON_ERROR_NO_SPACE if truncated (retry with a buffer of the needed size)
+int JSON_WriteToBuffer( const JSONNode root, int mode, char* buffer, size_t capacity, size_t* ref_neededSize );
+
+/// @brief Write JSON data tree to a stream, in fixed size chunks
+/// @param root root/base node of the tree to be written
+/// @param mode format of the string representation. Serialized (JSON_FMT_SERIAL) or idented (JSON_FMT_IDENT)
+/// @param file output stream
+/// @return JSON_OK on success, JSON_ERROR_OUTPUT on write errors
+int JSON_WriteToFile( const JSONNode root, int mode, FILE* file );
+
+/// @brief Write JSON data tree to a file descriptor, in fixed size chunks
+/// @param root root/base node of the tree to be written
+/// @param mode format of the string representation. Serialized (JSON_FMT_SERIAL) or idented (JSON_FMT_IDENT)
+/// @param fileDescriptor output file/socket descriptor (POSIX systems only)
+/// @return JSON_OK on success, JSON_ERROR_OUTPUT on write errors
+int JSON_WriteToFd( const JSONNode root, int mode, int fileDescriptor );
+
+/// @brief Read serialized JSON object directly into C structure, without building a tree nor allocating memory
+/// @param jsonData serialized JSON data (doesn't need to be null terminated)
+/// @param length size (in bytes) of data to be read
+/// @param descriptor table of structure fields. Unknown keys are skipped, and fields without key (or with null value) are left unchanged
+/// @param ref_structData pointer to structure receiving read values
+/// @return JSON_OK on success, JSON_ERROR_NO_SPACE for strings or arrays beyond field capacity, other JSON_ERROR_* codes for invalid or mismatched data
+int JSON_DecodeStruct( const char* jsonData, size_t length, const JSONField* descriptor, void* ref_structData );
+
+/// @brief Write C structure as serialized JSON object to a caller provided buffer, without allocating memory
+/// @param structData pointer to structure to be written
+/// @param descriptor table of structure fields, written in table order
+/// @param buffer destination of null terminated output
+/// @param capacity size (in bytes) of destination buffer
+/// @return JSON_OK on success, JSON_ERROR_NO_SPACE if output (with terminator) does not fit in buffer
+int JSON_EncodeStruct( const void* structData, const JSONField* descriptor, char* buffer, size_t capacity );
+
+/// @brief Write JSON data tree in CBOR (RFC 8949) binary format, with native numbers and length prefixed strings and containers
+/// @param root root/base node of the tree to be written
+/// @param buffer destination of encoded data. May be NULL, for computing the needed size
+/// @param capacity size (in bytes) of destination buffer
+/// @return size (in bytes) of the whole encoding. Output is complete only if not greater than capacity. 0 on errors
+size_t JSON_EncodeCBOR( const JSONNode root, void* buffer, size_t capacity );
+
+/// @brief Read CBOR (RFC 8949) encoded data into new JSON data tree
+/// @param data encoded data, as written by JSON_EncodeCBOR. Strings are taken as they are stored in nodes (with JSON escape sequences)
+/// @param length size (in bytes) of data to be read
+/// @return reference/pointer to root/base node of read tree. NULL on malformed data, or on items without JSON counterpart (byte strings, indefinite lengths)
+JSONNode JSON_DecodeCBOR( const void* data, size_t length );
+
 /// @brief Add JSON node to JSON_TYPE_BRACE type node
 /// @param root parent JSON_TYPE_BRACE type node to which new node will be added
 /// @param type type of new child node to be added
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                      //
+//  Copyright (c) 2016-2019 Leonardo Consoni <consoni_2519@hotmail.com>                 //
+//                                                                                      //
+//  This file is part of Platform Utils.                                                //
+//                                                                                      //
+//  Platform Utils is free software: you can redistribute it and/or modify              //
+//  it under the terms of the GNU Lesser General Public License as published            //
+//  by the Free Software Foundation, either version 3 of the License, or                //
+//  (at your option) any later version.                                                 //
+//                                                                                      //
+//  Platform Utils is distributed in the hope that it will be useful,                   //
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of                      //
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                        //
+//  GNU Lesser General Public License for more details.                                 //
+//                                                                                      //
+//  You should have received a copy of the GNU Lesser General Public License            //
+//  along with Platform Utils. If not, see <http://www.gnu.org/licenses/>.              //
+//                                                                                      //
+//////////////////////////////////////////////////////////////////////////////////////////
+
+// Check that trees encoded with JSON_EncodeCBOR and read back with JSON_DecodeCBOR are written as the same text
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "json.h"
+
+#define DEEP_LEVELS     100         // Nesting beyond the writer fixed stack
+
+// Numbers are given as written by the library, as text is generated again from decoded binary values
+static const char* DOCUMENTS_LIST[] = 
+{
+  "{ \"name\": \"cbor\", \"nested\": { \"list\": [ 1, -2, [ 3, [ 4, { \"deep\": [] } ] ], {} ], \"empty\": {} }, \"flag\": true, \"off\": false, \"none\": null }",
+  "[ 0, 23, 24, 255, 256, 65535, 65536, 4294967295, 4294967296, -1, -24, -25, -256, -257, 9223372036854775807, -9223372036854775808 ]",
+  "[ 0.5, -2.25, 3.141592653589793, 1e+300, -0, 1.5e-10, 0.1, 1e-300, 123456.789, -1.7976931348623157e+308 ]",
+  "[ \"quote \\\" backslash \\\\ slash \\/\", \"tab\\t newline\\n\", \"unicode \\u00e9 \\ud83d\\ude00 \xc3\xa9\", \"\", { \"escaped \\\"key\\\"\": \"value\" } ]",
+  "[ { \"id\": 1, \"name\": \"first\", \"tags\": [ \"a\" ] }, { \"id\": 2, \"name\": \"second\", \"tags\": [] }, { \"id\": 3, \"name\": null, \"tags\": [ true, false ] } ]",
+  "{ \"\": 0, \"duplicate\": 1, \"duplicate\": 2 }",
+  "\"root string\"",
+  "-0",
+  "true",
+  "[ [ [ [] ] ], {}, [ {} ] ]"
+};
+
+static bool CheckRoundTrip( const char* document )
+{
+  bool isEqual = false;
+  JSONNode root = JSON_Parse( document );
+  if( root == NULL ) 
+  {
+    fprintf( stderr, "parsing failed: %s\n", document );
+    return false;
+  }
+  size_t length = JSON_EncodeCBOR( root, NULL, 0 );
+  unsigned char* data = (unsigned char*) malloc( length + 1 );
+  if( length > 0 && JSON_EncodeCBOR( root, data, length ) == length ) 
+  {
+    JSONNode decodedRoot = JSON_DecodeCBOR( data, length );
+    isEqual = ( decodedRoot != NULL );
+    int modesList[] = { JSON_FORMAT_SERIAL, JSON_FORMAT_IDENT };
+    for( size_t modeIndex = 0; modeIndex < sizeof(modesList) / sizeof(int) && isEqual; modeIndex++ ) 
+    {
+      char* text = JSON_GetString( root, modesList[ modeIndex ] );
+      char* decodedText = JSON_GetString( decodedRoot, modesList[ modeIndex ] );
+      isEqual = ( text != NULL && decodedText != NULL && strcmp( text, decodedText ) == 0 );
+      if( !isEqual ) fprintf( stderr, "round trip mismatch:\n%s\n%s\n", text, decodedText );
+      free( text );
+      free( decodedText );
+    }
+    JSON_Destroy( decodedRoot );
+  }
+  else fprintf( stderr, "encoding failed: %s\n", document );
+  free( data );
+  JSON_Destroy( root );
+  return isEqual;
+}
+
+int main( void )
+{
+  int failuresCount = 0;
+  size_t documentsCount = sizeof(DOCUMENTS_LIST) / sizeof(const char*);
+  for( size_t documentIndex = 0; documentIndex < documentsCount; documentIndex++ ) 
+  {
+    bool isEqual = CheckRoundTrip( DOCUMENTS_LIST[ documentIndex ] );
+    printf( "document %zu: %s\n", documentIndex, isEqual ? "OK" : "FAILED" );
+    if( !isEqual ) failuresCount++;
+  }
+  // Arrays and objects nested alternately, around a single number
+  char deepDocument[ 6 * DEEP_LEVELS + 2 ];
+  size_t length = 0;
+  for( int level = 0; level < DEEP_LEVELS; level++ ) length += sprintf( deepDocument + length, ( level % 2 == 0 ) ? "[" : "{\"k\":" );
+  length += sprintf( deepDocument + length, "1" );
+  for( int level = DEEP_LEVELS - 1; level >= 0; level-- ) length += sprintf( deepDocument + length, ( level % 2 == 0 ) ? "]" : "}" );
+  bool isEqual = CheckRoundTrip( deepDocument );
+  printf( "deep document: %s\n", isEqual ? "OK" : "FAILED" );
+  if( !isEqual ) failuresCount++;
+  return ( failuresCount == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
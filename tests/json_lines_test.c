@@ -0,0 +1,135 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                      //
+//  Copyright (c) 2016-2019 Leonardo Consoni <consoni_2519@hotmail.com>                 //
+//                                                                                      //
+//  This file is part of Platform Utils.                                                //
+//                                                                                      //
+//  Platform Utils is free software: you can redistribute it and/or modify              //
+//  it under the terms of the GNU Lesser General Public License as published            //
+//  by the Free Software Foundation, either version 3 of the License, or                //
+//  (at your option) any later version.                                                 //
+//                                                                                      //
+//  Platform Utils is distributed in the hope that it will be useful,                   //
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of                      //
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                        //
+//  GNU Lesser General Public License for more details.                                 //
+//                                                                                      //
+//  You should have received a copy of the GNU Lesser General Public License            //
+//  along with Platform Utils. If not, see <http://www.gnu.org/licenses/>.              //
+//                                                                                      //
+//////////////////////////////////////////////////////////////////////////////////////////
+
+// Check JSON_ParseLines results with different numbers of workers, in ordered and unordered delivery modes.
+// Callbacks of unordered runs are concurrent, so this is meant to also run on a ThreadSanitizer build 
+// (e.g. cmake -DJSON_BUILD_TESTS=ON -DCMAKE_C_FLAGS=-fsanitize=thread)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "json.h"
+
+#define LINES_COUNT     40000
+#define INVALID_LINE    29999       // Record with a syntax error, checked for being reported by offset
+
+typedef struct _LinesCheck
+{
+  size_t* offsetsList;              // Start of each record line in the input
+  int* deliveriesList;              // Number of callback calls for each record
+  bool isOrdered;
+  size_t lastOffset;
+  int activeCallsCount;             // Callbacks running right now (at most 1 when ordered)
+  int failuresCount;
+}
+LinesCheck;
+
+static void Fail( LinesCheck* check, const char* message, size_t offset )
+{
+  fprintf( stderr, "%s (offset %zu)\n", message, offset );
+  __atomic_add_fetch( &(check->failuresCount), 1, __ATOMIC_RELAXED );
+}
+
+static long FindLine( const LinesCheck* check, size_t offset )
+{
+  long low = 0, high = LINES_COUNT - 1;
+  while( low <= high ) 
+  {
+    long middle = ( low + high ) / 2;
+    if( check->offsetsList[ middle ] == offset ) return middle;
+    if( check->offsetsList[ middle ] < offset ) low = middle + 1;
+    else high = middle - 1;
+  }
+  return -1;
+}
+
+static void CheckLine( void* userData, size_t offset, JSONNode root, int error )
+{
+  LinesCheck* check = (LinesCheck*) userData;
+  if( __atomic_add_fetch( &(check->activeCallsCount), 1, __ATOMIC_SEQ_CST ) > 1 && check->isOrdered ) 
+    Fail( check, "concurrent callbacks in ordered mode", offset );
+  if( check->isOrdered ) 
+  {
+    // Written without synchronization: ordered delivery must serialize the calls
+    if( check->lastOffset != (size_t) -1 && offset <= check->lastOffset ) Fail( check, "record delivered out of order", offset );
+    check->lastOffset = offset;
+  }
+  long lineIndex = FindLine( check, offset );
+  if( lineIndex < 0 ) Fail( check, "unknown record offset", offset );
+  else 
+  {
+    check->deliveriesList[ lineIndex ]++;        // Each record is delivered by a single thread
+    if( lineIndex == INVALID_LINE ) 
+    {
+      if( error == JSON_OK || root != NULL ) Fail( check, "invalid record accepted", offset );
+    }
+    else if( error != JSON_OK || root == NULL ) Fail( check, "valid record rejected", offset );
+    else 
+    {
+      char name[ 32 ];
+      sprintf( name, "record%ld", lineIndex );
+      JSONNode valuesNode = JSON_FindByKey( root, "values" );
+      if( JSON_GetInteger( JSON_FindByKey( root, "id" ) ) != lineIndex || strcmp( JSON_Get( JSON_FindByKey( root, "name" ) ), name ) != 0 
+          || JSON_GetChildrenCount( valuesNode ) != 3 || JSON_GetNumber( JSON_FindByIndex( valuesNode, 2 ) ) != lineIndex + 0.5 ) 
+        Fail( check, "wrong record contents", offset );
+    }
+  }
+  __atomic_sub_fetch( &(check->activeCallsCount), 1, __ATOMIC_SEQ_CST );
+}
+
+int main( void )
+{
+  size_t bufferSize = LINES_COUNT * 96, length = 0;
+  char* buffer = (char*) malloc( bufferSize );
+  LinesCheck check = { .offsetsList = (size_t*) malloc( LINES_COUNT * sizeof(size_t) ), .deliveriesList = (int*) malloc( LINES_COUNT * sizeof(int) ) };
+  for( long lineIndex = 0; lineIndex < LINES_COUNT; lineIndex++ ) 
+  {
+    if( lineIndex % 1000 == 0 ) length += sprintf( buffer + length, "\n" );          // Blank lines are skipped
+    check.offsetsList[ lineIndex ] = length;
+    if( lineIndex == INVALID_LINE ) length += sprintf( buffer + length, "{ \"id\": %ld, \"values\": [ 1, 2 } }\n", lineIndex );
+    else length += sprintf( buffer + length, "{ \"id\": %ld, \"name\": \"record%ld\", \"values\": [ true, null, %ld.5 ] }\n", lineIndex, lineIndex, lineIndex );
+  }
+  int threadsCountsList[] = { 1, 2, 4 };
+  for( size_t threadsIndex = 0; threadsIndex < sizeof(threadsCountsList) / sizeof(int); threadsIndex++ ) 
+  {
+    for( int orderIndex = 0; orderIndex < 2; orderIndex++ ) 
+    {
+      check.isOrdered = ( orderIndex == 1 );
+      check.lastOffset = (size_t) -1;
+      memset( check.deliveriesList, 0, LINES_COUNT * sizeof(int) );
+      int failuresCount = check.failuresCount;
+      int error = JSON_ParseLines( buffer, length, threadsCountsList[ threadsIndex ], check.isOrdered, CheckLine, &check );
+      if( error == JSON_OK ) Fail( &check, "invalid record not reported", check.offsetsList[ INVALID_LINE ] );
+      for( long lineIndex = 0; lineIndex < LINES_COUNT; lineIndex++ ) 
+      {
+        if( check.deliveriesList[ lineIndex ] != 1 ) Fail( &check, "record not delivered exactly once", check.offsetsList[ lineIndex ] );
+      }
+      printf( "%d threads, %s: %s\n", threadsCountsList[ threadsIndex ], check.isOrdered ? "ordered" : "unordered", 
+              ( check.failuresCount == failuresCount ) ? "OK" : "FAILED" );
+    }
+  }
+  free( check.offsetsList );
+  free( check.deliveriesList );
+  free( buffer );
+  return ( check.failuresCount == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}